@@ -0,0 +1,120 @@
+#ifndef GKXX_CTJSON_BATCH_HPP
+#define GKXX_CTJSON_BATCH_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "dom.hpp"
+
+// Parsing many small documents at once. Calling dom::parse on each of them
+// pays, per document, for a Parser, a key table and the allocations of a
+// fresh arena, which for messages of a few hundred bytes cost about as much
+// as the parse itself. parse_batch pays for them once: all documents are
+// parsed by one Parser into one arena, and share one key table, so messages
+// of the same layout also share their object shapes.
+
+namespace gkxx::ctjson::dom {
+
+/// @brief Thrown by parse_batch for an invalid message. position() is counted
+/// from the start of that message.
+class batch_parse_error : public parse_error {
+ public:
+  batch_parse_error(const parse_error &error, std::size_t index)
+      : parse_error(error.message() + " in message " + std::to_string(index),
+                    error.position()),
+        m_index{index} {}
+  std::size_t index() const noexcept {
+    return m_index;
+  }
+
+ private:
+  std::size_t m_index;
+};
+
+/// @brief The documents of a batch, in the order of the messages. They live in
+/// the arena of the batch and are released with it, all at once.
+class batch {
+ public:
+  explicit batch(std::size_t initial_size,
+                 std::pmr::memory_resource *upstream =
+                     std::pmr::get_default_resource())
+      : m_arena{std::make_unique<std::pmr::monotonic_buffer_resource>(
+            initial_size, upstream)},
+        m_documents(m_arena.get()) {}
+
+  batch(batch &&) noexcept = default;
+  // Member-wise assignment would release our arena before our documents, and
+  // move the other documents into it, as pmr containers do not propagate
+  // their allocator.
+  batch &operator=(batch &&other) noexcept {
+    if (this != &other) {
+      std::destroy_at(this);
+      std::construct_at(this, std::move(other));
+    }
+    return *this;
+  }
+
+  std::size_t size() const noexcept {
+    return m_documents.size();
+  }
+  bool empty() const noexcept {
+    return m_documents.empty();
+  }
+  const Value &operator[](std::size_t i) const noexcept {
+    return m_documents[i];
+  }
+  auto begin() const noexcept {
+    return m_documents.begin();
+  }
+  auto end() const noexcept {
+    return m_documents.end();
+  }
+
+  std::pmr::memory_resource *resource() const noexcept {
+    return m_arena.get();
+  }
+
+ private:
+  friend batch parse_batch(std::span<const std::string_view>,
+                           std::pmr::memory_resource *);
+
+  // Behind a pointer so that moving the batch does not move the arena the
+  // documents point into.
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> m_arena;
+  std::pmr::vector<Value> m_documents;
+};
+
+/// @brief Parses every message into a document of one batch.
+/// @param upstream Where the arena of the batch gets its memory. The first
+/// block is sized after the total length of the messages, so that a typical
+/// batch needs few upstream allocations.
+/// @throws batch_parse_error for the first invalid message.
+inline batch parse_batch(std::span<const std::string_view> messages,
+                         std::pmr::memory_resource *upstream =
+                             std::pmr::get_default_resource()) {
+  std::size_t bytes = 0;
+  for (auto message : messages)
+    bytes += message.size();
+  // A DOM takes a few times the size of its source.
+  batch result(4 * bytes + 1024, upstream);
+  result.m_documents.reserve(messages.size());
+  detail::Parser parser{{}, result.m_arena.get()};
+  for (std::size_t i = 0; i != messages.size(); ++i) {
+    try {
+      parser.reset(messages[i]);
+      result.m_documents.push_back(parser.parse_document());
+    } catch (const parse_error &e) {
+      throw batch_parse_error(e, i);
+    }
+  }
+  return result;
+}
+
+} // namespace gkxx::ctjson::dom
+
+#endif // GKXX_CTJSON_BATCH_HPP
@@ -0,0 +1,75 @@
+// Messages per second for a batch of small records: dom::parse in a loop,
+// with and without an arena per message, against parse_batch.
+//
+//   g++ -std=c++20 -O2 -I.. batch.cpp -o batch && ./batch [messages]
+
+#include "batch.hpp"
+#include "records.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Keeps the sums below from being optimized away.
+volatile long long sink;
+
+template <typename Run>
+void measure(const char *mode, std::size_t messages, std::size_t bytes,
+             Run run) {
+  using clock = std::chrono::steady_clock;
+  auto best = clock::duration::max();
+  for (int round = 0; round != 5; ++round) {
+    auto start = clock::now();
+    run();
+    best = std::min(best, clock::now() - start);
+  }
+  auto seconds = std::chrono::duration<double>(best).count();
+  std::printf("%-16s %12.0f messages/s  %6.1f ns/message  %6.3f GB/s\n", mode,
+              messages / seconds, seconds * 1e9 / messages,
+              bytes / seconds / 1e9);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace gkxx::ctjson;
+  auto count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000;
+  std::mt19937 rng{20240501};
+  std::vector<std::string> storage(count);
+  std::vector<std::string_view> messages;
+  std::size_t bytes = 0;
+  for (auto &message : storage) {
+    append_task_record(message, rng);
+    messages.push_back(message);
+    bytes += message.size();
+  }
+  std::printf("%zu messages, %zu bytes\n", messages.size(), bytes);
+
+  measure("parse", messages.size(), bytes, [&] {
+    long long sum = 0;
+    for (auto message : messages)
+      sum += dom::parse(message).find("priority")->as_integer();
+    sink = sum;
+  });
+  measure("parse + arena", messages.size(), bytes, [&] {
+    long long sum = 0;
+    for (auto message : messages) {
+      std::pmr::monotonic_buffer_resource arena;
+      sum += dom::parse(message, &arena).find("priority")->as_integer();
+    }
+    sink = sum;
+  });
+  measure("parse_batch", messages.size(), bytes, [&] {
+    long long sum = 0;
+    for (const auto &document : dom::parse_batch(messages))
+      sum += document.find("priority")->as_integer();
+    sink = sum;
+  });
+}
@@ -0,0 +1,169 @@
+#ifndef GKXX_CTJSON_BENCH_CORPUS_HPP
+#define GKXX_CTJSON_BENCH_CORPUS_HPP
+
+#include <cstddef>
+#include <random>
+#include <string>
+
+#include "records.hpp"
+
+// Synthetic documents of about `size` bytes each, the same for the same seed.
+
+namespace corpus {
+
+namespace detail {
+
+  inline std::string pick(std::mt19937 &rng,
+                          std::initializer_list<const char *> choices) {
+    std::uniform_int_distribution<std::size_t> index{0, choices.size() - 1};
+    return choices.begin()[index(rng)];
+  }
+
+  inline void append_words(std::string &out, std::mt19937 &rng,
+                           std::size_t count) {
+    std::uniform_int_distribution<int> length{1, 9};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+    std::uniform_int_distribution<int> special{0, 39};
+    for (std::size_t i = 0; i != count; ++i) {
+      if (i != 0)
+        out += ' ';
+      for (int n = length(rng); n != 0; --n)
+        out += static_cast<char>(letter(rng));
+      // Now and then something that has to be escaped.
+      switch (special(rng)) {
+      case 0:
+        out += "\\\"";
+        break;
+      case 1:
+        out += "\\\\";
+        break;
+      case 2:
+        out += "\\n";
+        break;
+      case 3:
+        out += "\\t";
+        break;
+      }
+    }
+  }
+
+} // namespace detail
+
+/// @brief An array of objects like `cppconfig` in test.cpp.
+inline std::string config(std::mt19937 &rng, std::size_t size) {
+  std::uniform_int_distribution<int> count{0, 5};
+  std::string out = "[";
+  while (out.size() < size) {
+    if (out.size() > 1)
+      out += ",\n";
+    out += R"({"name": ")" + detail::pick(rng, {"Linux", "Mac", "Win32"}) +
+           R"(", "intelliSenseMode": ")" +
+           detail::pick(rng, {"linux-clang-x64", "linux-gcc-x64",
+                              "macos-clang-arm64", "windows-msvc-x64"}) +
+           R"(", "compilerPath": "/usr/bin/)" +
+           detail::pick(rng, {"clang++-16", "g++-12", "g++-13"}) +
+           R"(", "cStandard": ")" + detail::pick(rng, {"c11", "c17", "c23"}) +
+           R"(", "cppStandard": ")" +
+           detail::pick(rng, {"c++17", "c++20", "c++23"}) +
+           R"(", "includePath": [)";
+    for (int n = count(rng), k = 0; k != n; ++k)
+      out += (k ? ", " : "") + std::string(R"("/usr/local/include/lib)") +
+             std::to_string(k) + '"';
+    out += R"(], "compilerArgs": [)";
+    for (int n = count(rng), k = 0; k != n; ++k)
+      out += (k ? ", " : "") +
+             ('"' + detail::pick(rng, {"-Wall", "-Wextra", "-Wpedantic",
+                                       "-O2", "-g"}) +
+              '"');
+    out += R"(], "version": 4})";
+  }
+  return out + "]";
+}
+
+/// @brief An object like `tasks` in test.cpp, with many tasks.
+inline std::string tasks(std::mt19937 &rng, std::size_t size) {
+  std::string out = R"({"version": "2.0.0", "tasks": [)";
+  auto first = true;
+  while (out.size() < size) {
+    if (!first)
+      out += ",\n";
+    first = false;
+    append_task_record(out, rng);
+  }
+  return out + "]}";
+}
+
+/// @brief An array of rows of 16 integers.
+inline std::string numbers(std::mt19937 &rng, std::size_t size) {
+  std::uniform_int_distribution<int> magnitude{0, 9};
+  std::uniform_int_distribution<int> value{-2147483647, 2147483647};
+  std::string out = "[";
+  while (out.size() < size) {
+    if (out.size() > 1)
+      out += ",\n";
+    out += '[';
+    for (int k = 0; k != 16; ++k) {
+      if (k != 0)
+        out += ", ";
+      // Mostly small numbers, some of every length.
+      auto v = value(rng);
+      for (int m = magnitude(rng); m < 9; ++m)
+        v /= 10;
+      out += std::to_string(v);
+    }
+    out += ']';
+  }
+  return out + "]";
+}
+
+/// @brief An array of log entries, mostly text.
+inline std::string logs(std::mt19937 &rng, std::size_t size) {
+  std::uniform_int_distribution<int> thread{1, 64};
+  std::uniform_int_distribution<int> words{4, 40};
+  int time = 1700000000;
+  std::string out = "[";
+  while (out.size() < size) {
+    if (out.size() > 1)
+      out += ",\n";
+    out += R"({"time": )" + std::to_string(time += thread(rng)) +
+           R"(, "level": ")" +
+           detail::pick(rng, {"debug", "info", "info", "info", "warn",
+                              "error"}) +
+           R"(", "thread": )" + std::to_string(thread(rng)) +
+           R"(, "message": ")";
+    detail::append_words(out, rng, static_cast<std::size_t>(words(rng)));
+    out += "\"}";
+  }
+  return out + "]";
+}
+
+/// @brief An array of chains of objects and arrays, `depth` levels each.
+inline std::string nested(std::mt19937 &rng, std::size_t size,
+                          std::size_t depth = 128) {
+  std::uniform_int_distribution<int> leaf{0, 1000};
+  std::string out = "[";
+  while (out.size() < size) {
+    if (out.size() > 1)
+      out += ",\n";
+    for (std::size_t d = 0; d != depth; ++d)
+      out += d % 2 ? "[" : R"({"a": )";
+    out += std::to_string(leaf(rng));
+    for (std::size_t d = depth; d-- != 0;)
+      out += d % 2 ? "]" : "}";
+  }
+  return out + "]";
+}
+
+/// @brief Task records, one per line.
+inline std::string ndjson(std::mt19937 &rng, std::size_t size) {
+  std::string out;
+  while (out.size() < size) {
+    append_task_record(out, rng);
+    out += '\n';
+  }
+  return out;
+}
+
+} // namespace corpus
+
+#endif // GKXX_CTJSON_BENCH_CORPUS_HPP
@@ -0,0 +1,492 @@
+// Times every runtime path on synthetic corpora and prints the results as
+// JSON, to be kept and compared with a later run:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. harness.cpp -o harness
+//   ./harness [--size MB] [--seed N] [--warmup N] [--repetitions N]
+//             [--filter TEXT] [--baseline FILE [--threshold PERCENT]]
+//
+// Each measurement is run `warmup` times untimed and `repetitions` times
+// timed. Times are in microseconds, with nearest-rank percentiles over the
+// repetitions, and throughput is in MB/s at the median. With --baseline, the
+// medians are compared with those of an earlier output, and the exit status
+// is 1 if any of them is slower by more than the threshold.
+
+#include "corpus.hpp"
+
+#include "dom.hpp"
+#include "ndjson.hpp"
+#include "ondemand.hpp"
+#include "parallel_parse.hpp"
+#include "query.hpp"
+#include "schema.hpp"
+#include "serialize.hpp"
+#include "writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace gkxx::ctjson;
+
+struct Options {
+  std::size_t size = 16; // MB per corpus
+  unsigned seed = 20240501;
+  std::size_t warmup = 2;
+  std::size_t repetitions = 10;
+  std::string filter;
+  std::string baseline;
+  int threshold = 10;
+};
+
+// Keeps the results below from being optimized away.
+volatile long long sink;
+
+struct Result {
+  std::string corpus;
+  std::string path;
+  std::size_t bytes;
+  std::vector<long long> micros; // sorted
+};
+
+long long percentile(const std::vector<long long> &sorted, int p) {
+  auto rank = (sorted.size() * static_cast<std::size_t>(p) + 99) / 100;
+  return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+
+// The DOM only holds 32-bit integers. Values that do not fit are rejected
+// rather than written wrapped.
+int checked_int(unsigned long long value, const char *what) {
+  if (value > static_cast<unsigned long long>(
+                  std::numeric_limits<int>::max())) {
+    std::fprintf(stderr, "%s %llu does not fit in the report\n", what, value);
+    std::exit(2);
+  }
+  return static_cast<int>(value);
+}
+
+int megabytes_per_second(std::size_t bytes, long long micros) {
+  return static_cast<int>(static_cast<long long>(bytes) /
+                          std::max(micros, 1LL));
+}
+
+class Harness {
+ public:
+  explicit Harness(const Options &options) : m_options{options} {}
+
+  /// @brief Times run(), which returns the number of bytes it handled.
+  void measure(std::string_view corpus, std::string_view path,
+               const std::function<std::size_t()> &run) {
+    auto name = std::string(corpus) + '/' + std::string(path);
+    if (name.find(m_options.filter) == std::string::npos)
+      return;
+    using clock = std::chrono::steady_clock;
+    Result result{std::string(corpus), std::string(path), 0, {}};
+    for (std::size_t i = 0; i != m_options.warmup; ++i)
+      result.bytes = run();
+    for (std::size_t i = 0; i != m_options.repetitions; ++i) {
+      auto start = clock::now();
+      result.bytes = run();
+      result.micros.push_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(clock::now() -
+                                                                start)
+              .count());
+    }
+    std::sort(result.micros.begin(), result.micros.end());
+    std::fprintf(stderr, "%-28s %8lld us  %6d MB/s\n", name.c_str(),
+                 percentile(result.micros, 50),
+                 megabytes_per_second(result.bytes,
+                                      percentile(result.micros, 50)));
+    m_results.push_back(std::move(result));
+  }
+
+  dom::Value report() const {
+    dom::Array results;
+    for (const auto &result : m_results) {
+      dom::ObjectBuilder entry;
+      auto median = percentile(result.micros, 50);
+      entry.add("corpus", std::string_view(result.corpus));
+      entry.add("path", std::string_view(result.path));
+      entry.add("bytes", checked_int(result.bytes, "bytes"));
+      auto time = [](long long micros) {
+        return checked_int(static_cast<unsigned long long>(micros), "time");
+      };
+      entry.add("min_us", time(result.micros.front()));
+      entry.add("median_us", time(median));
+      entry.add("p90_us", time(percentile(result.micros, 90)));
+      entry.add("p99_us", time(percentile(result.micros, 99)));
+      entry.add("max_us", time(result.micros.back()));
+      entry.add("mb_per_s", megabytes_per_second(result.bytes, median));
+      results.push_back(entry.finish());
+    }
+    dom::ObjectBuilder report;
+    // Checked by parse_options.
+    report.add("seed", static_cast<int>(m_options.seed));
+    report.add("size_mb", static_cast<int>(m_options.size));
+    report.add("warmup", static_cast<int>(m_options.warmup));
+    report.add("repetitions", static_cast<int>(m_options.repetitions));
+    report.add("results", std::move(results));
+    return report.finish();
+  }
+
+ private:
+  Options m_options;
+  std::vector<Result> m_results;
+};
+
+struct Task {
+  std::string label;
+  std::vector<std::string> args;
+  bool is_default;
+};
+
+using task_shape = parse<
+    R"([{"label": "string", "args": ["string"], "isDefault": "boolean"}])">::
+    result;
+
+using tasks_schema = parse<R"({
+  "type": "object",
+  "required": ["version", "tasks"],
+  "properties": {
+    "tasks": {
+      "type": "array",
+      "items": {
+        "type": "object",
+        "required": ["label", "type", "command", "group", "priority"],
+        "properties": {
+          "label": {"type": "string"},
+          "args": {"type": "array", "items": {"type": "string"}},
+          "group": {"type": "object", "required": ["kind", "isDefault"]},
+          "priority": {"type": "integer", "minimum": -500000, "maximum": 500000}
+        }
+      }
+    }
+  }
+})">::result;
+
+using config_schema = parse<R"({
+  "type": "array",
+  "items": {
+    "type": "object",
+    "required": ["name", "compilerPath", "version"],
+    "properties": {
+      "cStandard": {"enum": ["c11", "c17", "c23"]},
+      "compilerArgs": {"type": "array", "items": {"type": "string"}},
+      "version": {"type": "integer", "minimum": 1, "maximum": 4}
+    }
+  }
+})">::result;
+
+// dom::parse into an arena, which is freed untimed.
+void measure_parse(Harness &harness, std::string_view corpus,
+                   const std::string &input) {
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+  harness.measure(corpus, "parse", [&] {
+    arena.reset();
+    arena = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    sink = dom::parse(input, arena.get()).is_array();
+    return input.size();
+  });
+}
+
+void measure_parallel(Harness &harness, std::string_view corpus,
+                      const std::string &input,
+                      gkxx::work_stealing_pool &pool) {
+  harness.measure(corpus, "parse_parallel", [&] {
+    sink = dom::parse_parallel(input, pool, std::pmr::new_delete_resource(),
+                               {.chunk_size = std::size_t{1} << 18})
+               .is_array();
+    return input.size();
+  });
+}
+
+void measure_write(Harness &harness, std::string_view corpus,
+                   const dom::Value &document) {
+  dom::output_buffer out;
+  for (auto [path, style] : {std::pair{"write", dom::Style::Minified},
+                             std::pair{"write_pretty", dom::Style::Pretty}})
+    harness.measure(corpus, path, [&, style] {
+      out.clear();
+      dom::write(document, out, {style});
+      return out.size();
+    });
+}
+
+template <typename Access>
+void measure_ondemand(Harness &harness, std::string_view corpus,
+                      const std::string &input, Access access) {
+  harness.measure(corpus, "ondemand", [&] {
+    ondemand::Document document(input);
+    sink = access(document.root());
+    return input.size();
+  });
+}
+
+void run_all(Harness &harness, const Options &options) {
+  std::mt19937 rng{options.seed};
+  auto size = options.size << 20;
+  gkxx::work_stealing_pool pool(
+      std::max(1u, std::thread::hardware_concurrency()));
+
+  {
+    auto input = corpus::config(rng, size);
+    auto document = dom::parse(input);
+    measure_parse(harness, "config", input);
+    measure_parallel(harness, "config", input, pool);
+    measure_ondemand(harness, "config", input, [](ondemand::Value root) {
+      long long args = 0;
+      for (auto entry : root.get_array())
+        for (auto arg : entry.get_object()["compilerArgs"].get_array()) {
+          arg.skip();
+          ++args;
+        }
+      return args;
+    });
+    measure_write(harness, "config", document);
+    harness.measure("config", "validate", [&] {
+      sink = schema_validator<config_schema>{}(document);
+      return input.size();
+    });
+  }
+
+  {
+    auto input = corpus::tasks(rng, size);
+    auto document = dom::parse(input);
+    measure_parse(harness, "tasks", input);
+    measure_ondemand(harness, "tasks", input, [](ondemand::Value root) {
+      long long sum = 0;
+      for (auto task : root.get_object()["tasks"].get_array())
+        sum += task.get_object()["priority"].get_integer();
+      return sum;
+    });
+    measure_write(harness, "tasks", document);
+    harness.measure("tasks", "query", [&] {
+      long long sum = 0;
+      query::for_each<
+          ".tasks[] | select(.group.isDefault == true) | .priority">(
+          document, [&](const dom::Value &v) { sum += v.as_integer(); });
+      sink = sum;
+      return input.size();
+    });
+    harness.measure("tasks", "validate", [&] {
+      sink = schema_validator<tasks_schema>{}(document);
+      return input.size();
+    });
+    std::vector<Task> records;
+    for (const auto &task : document.find("tasks")->as_array()) {
+      auto &record = records.emplace_back();
+      record.label = task.find("label")->as_string();
+      for (const auto &arg : task.find("args")->as_array())
+        record.args.emplace_back(arg.as_string());
+      record.is_default = task.find("group")->find("isDefault")->as_bool();
+    }
+    std::string out;
+    harness.measure("tasks", "serialize", [&] {
+      out.clear();
+      serialize<task_shape>(records, out);
+      return out.size();
+    });
+  }
+
+  {
+    auto input = corpus::numbers(rng, size);
+    auto document = dom::parse(input);
+    measure_parse(harness, "numbers", input);
+    measure_parallel(harness, "numbers", input, pool);
+    measure_ondemand(harness, "numbers", input, [](ondemand::Value root) {
+      long long sum = 0;
+      for (auto row : root.get_array())
+        for (auto n : row.get_array())
+          sum += n.get_integer();
+      return sum;
+    });
+    measure_write(harness, "numbers", document);
+  }
+
+  {
+    auto input = corpus::logs(rng, size);
+    auto document = dom::parse(input);
+    measure_parse(harness, "logs", input);
+    measure_parallel(harness, "logs", input, pool);
+    measure_ondemand(harness, "logs", input, [](ondemand::Value root) {
+      long long errors = 0;
+      for (auto entry : root.get_array())
+        for (auto field : entry.get_object())
+          if (field.key_equals("level"))
+            errors += field.value().get_raw_string() == "error";
+          else
+            field.value().skip();
+      return errors;
+    });
+    measure_write(harness, "logs", document);
+    harness.measure("logs", "query", [&] {
+      long long count = 0;
+      query::for_each<R"(.[] | select(.level == "error") | .message)">(
+          document, [&](const dom::Value &) { ++count; });
+      sink = count;
+      return input.size();
+    });
+  }
+
+  {
+    auto input = corpus::nested(rng, size);
+    auto document = dom::parse(input);
+    measure_parse(harness, "nested", input);
+    measure_parallel(harness, "nested", input, pool);
+    measure_ondemand(harness, "nested", input, [](ondemand::Value root) {
+      long long chains = 0;
+      for (auto chain : root.get_array()) {
+        chain.skip();
+        ++chains;
+      }
+      return chains;
+    });
+    measure_write(harness, "nested", document);
+  }
+
+  {
+    auto input = corpus::ndjson(rng, size);
+    harness.measure("ndjson", "for_each_record", [&] {
+      long long sum = 0;
+      ndjson::for_each_record(input, pool, [&](const dom::Value &record) {
+        sum += record.find("priority")->as_integer();
+      });
+      sink = sum;
+      return input.size();
+    });
+  }
+}
+
+// Whether `value` has the members that compare() reads, as written by
+// Harness::report().
+bool is_report(const dom::Value &value) {
+  auto has = [](const dom::Value &v, const char *key, auto is_kind) {
+    auto member = v.find(key);
+    return member && (member->*is_kind)();
+  };
+  if (!has(value, "seed", &dom::Value::is_integer) ||
+      !has(value, "size_mb", &dom::Value::is_integer) ||
+      !has(value, "results", &dom::Value::is_array))
+    return false;
+  return std::ranges::all_of(
+      value.find("results")->as_array(), [&](const dom::Value &result) {
+        return has(result, "corpus", &dom::Value::is_string) &&
+               has(result, "path", &dom::Value::is_string) &&
+               has(result, "median_us", &dom::Value::is_integer);
+      });
+}
+
+// Reads the report of an earlier run, exiting with status 2 if it cannot be
+// read or is not a report.
+dom::Value read_baseline(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::fprintf(stderr, "cannot open %s\n", path.c_str());
+    std::exit(2);
+  }
+  std::string text{std::istreambuf_iterator<char>(file), {}};
+  try {
+    auto baseline = dom::parse(text);
+    if (is_report(baseline))
+      return baseline;
+    std::fprintf(stderr, "%s is not a harness report\n", path.c_str());
+  } catch (const dom::parse_error &e) {
+    std::fprintf(stderr, "cannot parse %s: %s\n", path.c_str(), e.what());
+  }
+  std::exit(2);
+}
+
+// Prints the change of every median from the baseline, and returns whether
+// none is slower by more than the threshold. Both must be reports.
+bool compare(const dom::Value &report, const dom::Value &baseline,
+             int threshold) {
+  for (auto key : {"seed", "size_mb"})
+    if (report.find(key)->as_integer() != baseline.find(key)->as_integer())
+      std::fprintf(stderr, "warning: %s differs from the baseline\n", key);
+  auto passed = true;
+  for (const auto &result : report.find("results")->as_array()) {
+    const auto &corpus = result.find("corpus")->as_string();
+    const auto &path = result.find("path")->as_string();
+    for (const auto &old : baseline.find("results")->as_array()) {
+      if (old.find("corpus")->as_string() != corpus ||
+          old.find("path")->as_string() != path)
+        continue;
+      auto before = std::max(old.find("median_us")->as_integer(), 1);
+      auto after = result.find("median_us")->as_integer();
+      auto change = static_cast<long long>(after - before) * 100 / before;
+      auto regressed = change > threshold;
+      passed = passed && !regressed;
+      std::fprintf(stderr, "%-28s %8d -> %8d us  %+4lld%%%s\n",
+                   (std::string(corpus) + '/' + std::string(path)).c_str(),
+                   before, after, change, regressed ? "  REGRESSION" : "");
+    }
+  }
+  return passed;
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i += 2) {
+    std::string_view flag = argv[i];
+    if (i + 1 == argc) {
+      std::fprintf(stderr, "%s expects a value\n", argv[i]);
+      std::exit(2);
+    }
+    auto number = [&] {
+      return checked_int(std::strtoull(argv[i + 1], nullptr, 10), argv[i]);
+    };
+    if (flag == "--size") {
+      // Every corpus must have a size in bytes that fits in the report.
+      options.size = number();
+      if (options.size >= 2048) {
+        std::fprintf(stderr, "--size must be below 2048\n");
+        std::exit(2);
+      }
+    } else if (flag == "--seed")
+      options.seed = static_cast<unsigned>(number());
+    else if (flag == "--warmup")
+      options.warmup = number();
+    else if (flag == "--repetitions")
+      options.repetitions = std::max<std::size_t>(number(), 1);
+    else if (flag == "--filter")
+      options.filter = argv[i + 1];
+    else if (flag == "--baseline")
+      options.baseline = argv[i + 1];
+    else if (flag == "--threshold")
+      options.threshold = number();
+    else {
+      std::fprintf(stderr, "unknown option %s\n", argv[i]);
+      std::exit(2);
+    }
+  }
+  return options;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto options = parse_options(argc, argv);
+  // Read before the run, so that a bad baseline does not waste it.
+  std::optional<dom::Value> baseline;
+  if (!options.baseline.empty())
+    baseline = read_baseline(options.baseline);
+  Harness harness{options};
+  run_all(harness, options);
+  auto report = harness.report();
+  std::printf("%s\n", dom::to_string(report, {dom::Style::Pretty}).c_str());
+  if (!baseline)
+    return 0;
+  return compare(report, *baseline, options.threshold) ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// Throughput of ndjson::for_each_record for 1, 2, 4, ... threads.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. ndjson.cpp -o ndjson && ./ndjson [records]
+
+#include "ndjson.hpp"
+#include "records.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Keeps the sums below from being optimized away.
+volatile long long sink;
+
+std::string generate(std::size_t records) {
+  std::mt19937 rng{20240501};
+  std::string out;
+  for (std::size_t i = 0; i != records; ++i) {
+    append_task_record(out, rng);
+    out += '\n';
+  }
+  return out;
+}
+
+template <typename Run>
+void measure(const char *mode, std::size_t threads, std::size_t bytes,
+             Run run) {
+  using clock = std::chrono::steady_clock;
+  auto best = clock::duration::max();
+  std::size_t records = 0;
+  for (int round = 0; round != 3; ++round) {
+    auto start = clock::now();
+    records = run();
+    best = std::min(best, clock::now() - start);
+  }
+  auto seconds = std::chrono::duration<double>(best).count();
+  std::printf("%-9s %2zu threads  %12.0f records/s  %6.3f GB/s\n", mode,
+              threads, records / seconds, bytes / seconds / 1e9);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace gkxx::ctjson;
+  auto input = generate(argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                 : 1'000'000);
+  std::printf("%zu bytes\n", input.size());
+  auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+    gkxx::work_stealing_pool pool(threads);
+    measure("ordered", threads, input.size(), [&] {
+      long long sum = 0;
+      auto count = ndjson::for_each_record(input, pool, [&](const auto &r) {
+        sum += r.find("priority")->as_integer();
+      });
+      sink = sum;
+      return count;
+    });
+    measure("unordered", threads, input.size(), [&] {
+      std::atomic<long long> sum{0};
+      auto count = ndjson::for_each_record(
+          input, pool,
+          [&](const auto &r) {
+            sum.fetch_add(r.find("priority")->as_integer(),
+                          std::memory_order_relaxed);
+          },
+          {.order = ndjson::Order::Unordered});
+      sink = sum;
+      return count;
+    });
+  }
+}
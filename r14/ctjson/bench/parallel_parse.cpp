@@ -0,0 +1,60 @@
+// dom::parse against dom::parse_parallel on one large array, for 1, 2, 4, ...
+// threads.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. parallel_parse.cpp -o parallel_parse
+//   ./parallel_parse [records]
+
+#include "parallel_parse.hpp"
+#include "records.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string generate(std::size_t records) {
+  std::mt19937 rng{20240501};
+  std::string out = "[";
+  for (std::size_t i = 0; i != records; ++i) {
+    if (i != 0)
+      out += ",\n";
+    append_task_record(out, rng);
+  }
+  out += "]\n";
+  return out;
+}
+
+template <typename Run>
+void measure(const char *mode, std::size_t threads, std::size_t bytes,
+             Run run) {
+  using clock = std::chrono::steady_clock;
+  auto best = clock::duration::max();
+  for (int round = 0; round != 3; ++round) {
+    auto start = clock::now();
+    run();
+    best = std::min(best, clock::now() - start);
+  }
+  auto seconds = std::chrono::duration<double>(best).count();
+  std::printf("%-8s %2zu threads  %8.3f s  %6.3f GB/s\n", mode, threads,
+              seconds, bytes / seconds / 1e9);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace gkxx::ctjson;
+  auto input = generate(argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                 : 1'000'000);
+  std::printf("%zu bytes\n", input.size());
+  measure("serial", 1, input.size(), [&] { dom::parse(input); });
+  auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+    gkxx::work_stealing_pool pool(threads);
+    measure("parallel", threads, input.size(),
+            [&] { dom::parse_parallel(input, pool); });
+  }
+}
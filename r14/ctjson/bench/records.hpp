@@ -0,0 +1,27 @@
+#ifndef GKXX_CTJSON_BENCH_RECORDS_HPP
+#define GKXX_CTJSON_BENCH_RECORDS_HPP
+
+#include <random>
+#include <string>
+
+// Records shaped like the `tasks` of test.cpp.
+inline void append_task_record(std::string &out, std::mt19937 &rng) {
+  std::uniform_int_distribution<int> id{0, 1'000'000};
+  std::uniform_int_distribution<int> coin{0, 1};
+  std::uniform_int_distribution<int> args{0, 6};
+  out += R"({"label": "build-)";
+  out += std::to_string(id(rng));
+  out += R"(", "type": "shell", "command": "/usr/bin/g++", "args": [)";
+  for (int n = args(rng), k = 0; k != n; ++k) {
+    if (k != 0)
+      out += ", ";
+    out += "\"-O" + std::to_string(k) + '"';
+  }
+  out += R"(], "group": {"kind": "build", "isDefault": )";
+  out += coin(rng) ? "true" : "false";
+  out += R"(}, "priority": )";
+  out += std::to_string(id(rng) - 500'000);
+  out += "}";
+}
+
+#endif // GKXX_CTJSON_BENCH_RECORDS_HPP
@@ -0,0 +1,55 @@
+// Throughput of dom::write into a reused buffer, in bytes of output.
+//
+//   g++ -std=c++20 -O2 -march=native -I.. writer.cpp -o writer && ./writer [records]
+
+#include "records.hpp"
+#include "writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+std::string generate(std::size_t records) {
+  std::mt19937 rng{20240501};
+  std::string out = "[";
+  for (std::size_t i = 0; i != records; ++i) {
+    if (i != 0)
+      out += ", ";
+    append_task_record(out, rng);
+  }
+  out += "]";
+  return out;
+}
+
+void measure(const char *style, const gkxx::ctjson::dom::Value &document,
+             const gkxx::ctjson::dom::WriteOptions &options) {
+  using namespace gkxx::ctjson;
+  using clock = std::chrono::steady_clock;
+  dom::output_buffer out;
+  auto best = clock::duration::max();
+  for (int round = 0; round != 5; ++round) {
+    out.clear();
+    auto start = clock::now();
+    dom::write(document, out, options);
+    best = std::min(best, clock::now() - start);
+  }
+  auto seconds = std::chrono::duration<double>(best).count();
+  std::printf("%-8s %12zu bytes  %6.3f GB/s\n", style, out.size(),
+              out.size() / seconds / 1e9);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace gkxx::ctjson;
+  auto input = generate(argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                 : 1'000'000);
+  auto document = dom::parse(input);
+  measure("minified", document, {});
+  measure("spaced", document, {dom::Style::Spaced});
+  measure("pretty", document, {dom::Style::Pretty});
+}
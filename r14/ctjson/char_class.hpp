@@ -0,0 +1,468 @@
+#ifndef GKXX_CTJSON_CHAR_CLASS_HPP
+#define GKXX_CTJSON_CHAR_CLASS_HPP
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+
+/*
+The lexical grammar of ctjson as a DFA over character classes, shared by the
+compile-time Tokenizer and the runtime lexers.
+
+  Start   --'{' '}' '[' ']' ',' ':'--> Accept
+          --'"'--> String --'"'--> Accept
+                          --'\\'--> Escape --'\\' 'n' 'r' 't' '"'--> String
+                                             --'u'--> Unicode1 --hex--> ...
+                                                 Unicode4 --hex--> String
+          --'-'--> Minus --digit--> Digits
+          --digit--> Digits --non-digit--> AcceptBefore
+          --'t'--> 'r' 'u' 'e' --> Accept
+          --'f'--> 'a' 'l' 's' 'e' --> Accept
+          --'n'--> 'u' 'l' 'l' --> Accept
+
+Every other transition goes to the error state of the token being read. The
+end of the input is a class of its own. Leading zeros, the number of digits
+and the range of integers are checked on the lexeme afterwards, by
+check_integer.
+
+A \uXXXX escape stands for its code point in UTF-8. A high surrogate followed
+by the escape of a low surrogate stands for the pair; any other surrogate
+stands for U+FFFD.
+ */
+
+namespace gkxx::ctjson::lex {
+
+enum class char_class : unsigned char {
+  Other,
+  Whitespace,
+  Digit,
+  Minus,
+  Quote,
+  Backslash,
+  Punct,
+  // The letters of the keywords and escapes.
+  A,
+  E,
+  F,
+  L,
+  N,
+  R,
+  S,
+  T,
+  U,
+  // The other hex digits: 'b' 'c' 'd' and 'A' to 'F'.
+  HexLetter,
+  EndOfInput,
+  Count
+};
+
+enum class state : unsigned char {
+  Start,
+  String,
+  Escape,
+  Unicode1,
+  Unicode2,
+  Unicode3,
+  Unicode4,
+  Minus,
+  Digits,
+  True1,
+  True2,
+  True3,
+  False1,
+  False2,
+  False3,
+  False4,
+  Null1,
+  Null2,
+  Null3,
+  // The token ends with the current character.
+  Accept,
+  // The token ends before the current character.
+  AcceptBefore,
+  // Errors, reported at the start of the token unless noted otherwise.
+  InvalidString,
+  UnsupportedEscape, // at the character after '\\'
+  ExpectsTrue,
+  ExpectsFalse,
+  ExpectsNull,
+  ExpectsInteger, // at the character after '-'
+  Unrecognized,
+  Count
+};
+
+inline constexpr std::size_t class_count =
+    static_cast<std::size_t>(char_class::Count);
+inline constexpr std::size_t state_count =
+    static_cast<std::size_t>(state::Count);
+
+inline consteval auto make_char_classes() {
+  std::array<char_class, 256> table{};
+  for (auto c : std::string_view{" \n\t\r"})
+    table[static_cast<unsigned char>(c)] = char_class::Whitespace;
+  for (auto c = '0'; c <= '9'; ++c)
+    table[static_cast<unsigned char>(c)] = char_class::Digit;
+  for (auto c : std::string_view{"{}[],:"})
+    table[static_cast<unsigned char>(c)] = char_class::Punct;
+  table['-'] = char_class::Minus;
+  table['"'] = char_class::Quote;
+  table['\\'] = char_class::Backslash;
+  table['a'] = char_class::A;
+  table['e'] = char_class::E;
+  table['f'] = char_class::F;
+  table['l'] = char_class::L;
+  table['n'] = char_class::N;
+  table['r'] = char_class::R;
+  table['s'] = char_class::S;
+  table['t'] = char_class::T;
+  table['u'] = char_class::U;
+  for (auto c : std::string_view{"bcdABCDEF"})
+    table[static_cast<unsigned char>(c)] = char_class::HexLetter;
+  return table;
+}
+
+inline constexpr auto char_classes = make_char_classes();
+
+constexpr char_class classify(char c) noexcept {
+  return char_classes[static_cast<unsigned char>(c)];
+}
+
+inline consteval auto make_transitions() {
+  using enum char_class;
+  std::array<std::array<state, class_count>, state_count> table{};
+  auto row = [&](state from, state otherwise) -> auto & {
+    auto &r = table[static_cast<std::size_t>(from)];
+    r.fill(otherwise);
+    return r;
+  };
+  auto at = [](auto &r, char_class c) -> state & {
+    return r[static_cast<std::size_t>(c)];
+  };
+
+  auto &start = row(state::Start, state::Unrecognized);
+  at(start, Punct) = state::Accept;
+  at(start, Quote) = state::String;
+  at(start, Minus) = state::Minus;
+  at(start, Digit) = state::Digits;
+  at(start, T) = state::True1;
+  at(start, F) = state::False1;
+  at(start, N) = state::Null1;
+
+  auto &string = row(state::String, state::String);
+  at(string, Quote) = state::Accept;
+  at(string, Backslash) = state::Escape;
+  at(string, EndOfInput) = state::InvalidString;
+
+  auto &escape = row(state::Escape, state::UnsupportedEscape);
+  for (auto c : {Backslash, N, R, T, Quote})
+    at(escape, c) = state::String;
+  at(escape, U) = state::Unicode1;
+  for (auto [from, to] : {std::pair{state::Unicode1, state::Unicode2},
+                          std::pair{state::Unicode2, state::Unicode3},
+                          std::pair{state::Unicode3, state::Unicode4},
+                          std::pair{state::Unicode4, state::String}}) {
+    auto &hex = row(from, state::UnsupportedEscape);
+    for (auto c : {Digit, A, E, F, HexLetter})
+      at(hex, c) = to;
+  }
+
+  at(row(state::Minus, state::ExpectsInteger), Digit) = state::Digits;
+  at(row(state::Digits, state::AcceptBefore), Digit) = state::Digits;
+
+  at(row(state::True1, state::ExpectsTrue), R) = state::True2;
+  at(row(state::True2, state::ExpectsTrue), U) = state::True3;
+  at(row(state::True3, state::ExpectsTrue), E) = state::Accept;
+  at(row(state::False1, state::ExpectsFalse), A) = state::False2;
+  at(row(state::False2, state::ExpectsFalse), L) = state::False3;
+  at(row(state::False3, state::ExpectsFalse), S) = state::False4;
+  at(row(state::False4, state::ExpectsFalse), E) = state::Accept;
+  at(row(state::Null1, state::ExpectsNull), U) = state::Null2;
+  at(row(state::Null2, state::ExpectsNull), L) = state::Null3;
+  at(row(state::Null3, state::ExpectsNull), L) = state::Accept;
+  return table;
+}
+
+inline constexpr auto transitions = make_transitions();
+
+constexpr state next_state(state s, char_class c) noexcept {
+  return transitions[static_cast<std::size_t>(s)][static_cast<std::size_t>(c)];
+}
+
+constexpr bool is_error(state s) noexcept {
+  return s >= state::InvalidString;
+}
+
+// Whether the token is complete, or invalid, in state s.
+constexpr bool is_final(state s) noexcept {
+  return s >= state::Accept;
+}
+
+// The bytes on which the String state stays where it is, which scan() skips
+// with one lookup each.
+inline constexpr auto string_bytes = [] {
+  std::array<bool, 256> table{};
+  for (std::size_t c = 0; c != 256; ++c)
+    table[c] = next_state(state::String, char_classes[c]) == state::String;
+  return table;
+}();
+
+enum class token_kind : unsigned char {
+  Punct,
+  String,
+  Integer,
+  True,
+  False,
+  Null,
+  Error
+};
+
+/// @brief A token read from src[begin, end), or the error met while reading
+/// it. For strings, `escapes` is the number of bytes that the escape sequences
+/// take beyond the bytes they stand for, and is 0 only without escapes.
+struct lexeme {
+  token_kind kind;
+  std::size_t begin;
+  std::size_t end;
+  std::size_t escapes = 0;
+  std::string_view error = {};
+  std::size_t error_position = 0;
+};
+
+constexpr std::string_view message_of(state s) noexcept {
+  switch (s) {
+  case state::InvalidString:
+    return "invalid string";
+  case state::UnsupportedEscape:
+    return "unsupported escape";
+  case state::ExpectsTrue:
+    return "expects 'true'";
+  case state::ExpectsFalse:
+    return "expects 'false'";
+  case state::ExpectsNull:
+    return "expects 'null'";
+  case state::ExpectsInteger:
+    return "expects integer";
+  default:
+    return "Unrecognized token";
+  }
+}
+
+constexpr token_kind kind_of(char first) noexcept {
+  switch (classify(first)) {
+  case char_class::Punct:
+    return token_kind::Punct;
+  case char_class::Quote:
+    return token_kind::String;
+  case char_class::T:
+    return token_kind::True;
+  case char_class::F:
+    return token_kind::False;
+  case char_class::N:
+    return token_kind::Null;
+  default:
+    return token_kind::Integer;
+  }
+}
+
+constexpr unsigned hex_value(char c) noexcept {
+  if (c >= '0' && c <= '9')
+    return static_cast<unsigned>(c - '0');
+  return static_cast<unsigned>((c | 0x20) - 'a' + 10);
+}
+
+constexpr bool is_high_surrogate(unsigned code) noexcept {
+  return code >= 0xd800 && code <= 0xdbff;
+}
+
+constexpr bool is_low_surrogate(unsigned code) noexcept {
+  return code >= 0xdc00 && code <= 0xdfff;
+}
+
+// The number of bytes that a \uXXXX escape of `code` stands for, if it is not
+// part of a surrogate pair.
+constexpr std::size_t utf8_size(unsigned code) noexcept {
+  return code < 0x80 ? 1 : code < 0x800 ? 2 : 3;
+}
+
+/// @brief Runs the DFA from src[pos], which must not be whitespace. Src is a
+/// std::string_view at run time, or a fixed_string or byte_source at compile
+/// time.
+template <typename Source>
+constexpr lexeme scan(const Source &src, std::size_t pos) noexcept {
+  auto s = state::Start;
+  std::size_t escapes = 0;
+  unsigned code = 0;
+  // Where the escape of a low surrogate must start to pair with the last high
+  // surrogate.
+  std::size_t pair_at = 0;
+  auto cur = pos;
+  for (;; ++cur) {
+    auto c = cur < src.size() ? classify(src[cur]) : char_class::EndOfInput;
+    auto from = s;
+    s = next_state(s, c);
+    if (from >= state::Unicode1 && from <= state::Unicode4 && !is_error(s)) {
+      code = code * 16 + hex_value(src[cur]);
+      if (from == state::Unicode4) {
+        // Six bytes, one of them counted at the '\\'. A pair stands for 4
+        // bytes, 3 of them counted at its high surrogate.
+        auto low_pair = is_low_surrogate(code) && cur == pair_at + 5;
+        escapes += 5 - (low_pair ? 1 : utf8_size(code));
+        pair_at = is_high_surrogate(code) ? cur + 1 : 0;
+      }
+    }
+    if (s == state::String)
+      while (cur + 1 < src.size() &&
+             string_bytes[static_cast<unsigned char>(src[cur + 1])])
+        ++cur;
+    else if (s == state::Escape) {
+      ++escapes;
+      code = 0;
+    }
+    if (s == state::Accept)
+      return {kind_of(src[pos]), pos, cur + 1, escapes};
+    if (s == state::AcceptBefore)
+      return {token_kind::Integer, pos, cur};
+    if (is_error(s)) {
+      auto at = s == state::UnsupportedEscape || s == state::ExpectsInteger
+                    ? cur
+                    : pos;
+      return {token_kind::Error, pos, cur, 0, message_of(s), at};
+    }
+  }
+}
+
+/// @brief The character that the escape sequence '\\' c stands for.
+constexpr char unescape(char c) noexcept {
+  switch (c) {
+  case 'n':
+    return '\n';
+  case 'r':
+    return '\r';
+  case 't':
+    return '\t';
+  default: // '\\' or '"'
+    return c;
+  }
+}
+
+/// @brief Reads the contents src[begin, end) of a string, between its quotes,
+/// one byte at a time with its escape sequences replaced.
+template <typename Source>
+class contents_reader {
+ public:
+  constexpr contents_reader(const Source &src, std::size_t begin,
+                            std::size_t end) noexcept
+      : m_src{src}, m_pos{begin}, m_end{end} {}
+
+  constexpr bool done() const noexcept {
+    return m_next == m_buffered && m_pos == m_end;
+  }
+
+  constexpr char get() noexcept {
+    if (m_next != m_buffered)
+      return m_buffer[m_next++];
+    auto c = m_src[m_pos++];
+    if (c != '\\')
+      return c;
+    c = m_src[m_pos++];
+    if (c != 'u')
+      return unescape(c);
+    auto code = read_code();
+    if (is_high_surrogate(code) && m_end - m_pos >= 6 &&
+        m_src[m_pos] == '\\' && m_src[m_pos + 1] == 'u') {
+      auto pos = m_pos;
+      m_pos += 2;
+      auto low = read_code();
+      if (is_low_surrogate(low))
+        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+      else
+        m_pos = pos;
+    }
+    if (is_high_surrogate(code) || is_low_surrogate(code))
+      code = 0xfffd;
+    encode(code);
+    return m_buffer[m_next++];
+  }
+
+ private:
+  constexpr unsigned read_code() noexcept {
+    unsigned code = 0;
+    for (auto end = m_pos + 4; m_pos != end; ++m_pos)
+      code = code * 16 + hex_value(m_src[m_pos]);
+    return code;
+  }
+
+  constexpr void encode(unsigned code) noexcept {
+    auto byte = [](unsigned b) { return static_cast<char>(b); };
+    m_next = 0;
+    if (code < 0x80) {
+      m_buffer[0] = byte(code);
+      m_buffered = 1;
+    } else if (code < 0x800) {
+      m_buffer[0] = byte(0xc0 | code >> 6);
+      m_buffer[1] = byte(0x80 | (code & 0x3f));
+      m_buffered = 2;
+    } else if (code < 0x10000) {
+      m_buffer[0] = byte(0xe0 | code >> 12);
+      m_buffer[1] = byte(0x80 | (code >> 6 & 0x3f));
+      m_buffer[2] = byte(0x80 | (code & 0x3f));
+      m_buffered = 3;
+    } else {
+      m_buffer[0] = byte(0xf0 | code >> 18);
+      m_buffer[1] = byte(0x80 | (code >> 12 & 0x3f));
+      m_buffer[2] = byte(0x80 | (code >> 6 & 0x3f));
+      m_buffer[3] = byte(0x80 | (code & 0x3f));
+      m_buffered = 4;
+    }
+  }
+
+  const Source &m_src;
+  std::size_t m_pos;
+  std::size_t m_end;
+  char m_buffer[4]{};
+  unsigned char m_buffered = 0;
+  unsigned char m_next = 0;
+};
+
+/// @brief Appends the contents of the string lexeme src[begin, end) to out,
+/// without the quotes and with its escape sequences replaced.
+template <typename Source, typename String>
+constexpr void append_contents(const Source &src, std::size_t begin,
+                               std::size_t end, String &out) {
+  for (contents_reader reader{src, begin + 1, end - 1}; !reader.done();)
+    out += reader.get();
+}
+
+/// @brief The value of the integer lexeme src[begin, end), or the error that
+/// makes it invalid.
+struct integer_value {
+  int value = 0;
+  std::string_view error = {};
+  std::size_t error_position = 0;
+};
+
+template <typename Source>
+constexpr integer_value check_integer(const Source &src, std::size_t begin,
+                                      std::size_t end) noexcept {
+  auto neg = src[begin] == '-';
+  auto start = neg ? begin + 1 : begin;
+  auto digits = end - start;
+  if (digits > 10)
+    return {0, "integer too long", start};
+  if (digits >= 2 && src[start] == '0')
+    return {0, "too many leading zeros", start};
+  unsigned long value = 0;
+  for (auto i = start; i != end; ++i)
+    value = value * 10 + static_cast<unsigned long>(src[i] - '0');
+  if (value > 2147483647ul + static_cast<unsigned long>(neg))
+    return {0, "integer value exceeding the range of 32-bit signed integers",
+            start};
+  return {neg ? static_cast<int>(-static_cast<long>(value))
+              : static_cast<int>(value)};
+}
+
+} // namespace gkxx::ctjson::lex
+
+#endif // GKXX_CTJSON_CHAR_CLASS_HPP
@@ -0,0 +1,439 @@
+#ifndef GKXX_CTJSON_COLUMNAR_HPP
+#define GKXX_CTJSON_COLUMNAR_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ctjson.hpp"
+#include "dom.hpp"
+#include "is_specialization_of.hpp"
+
+// Columnar (struct-of-arrays) form of an array of objects: one typed column
+// per key, each a contiguous vector with a validity bitmap. A value that is
+// missing, null or of another type than its column is invalid and stored as
+// 0, false or "", so that kernels may run over whole columns without
+// branching and mask the result with the validity bitmap afterwards.
+//
+// The columns come either from a compile-time ctjson sample record or from
+// the keys met while converting. Consecutive rows sharing a shape (see
+// dom::Object::same_shape) reuse the mapping from members to columns, so a
+// homogeneous array is converted without looking any key up after the first
+// row.
+
+namespace gkxx::ctjson::columnar {
+
+/// @brief A packed sequence of bits.
+class bitmap {
+ public:
+  bitmap() noexcept = default;
+  explicit bitmap(std::size_t size, bool value = false)
+      : m_words((size + 63) / 64, value ? ~std::uint64_t{0} : 0),
+        m_size{size} {
+    clear_tail();
+  }
+
+  std::size_t size() const noexcept {
+    return m_size;
+  }
+  bool test(std::size_t i) const noexcept {
+    return (m_words[i / 64] >> (i % 64)) & 1;
+  }
+  void set(std::size_t i, bool value = true) noexcept {
+    auto bit = std::uint64_t{1} << (i % 64);
+    m_words[i / 64] = value ? m_words[i / 64] | bit : m_words[i / 64] & ~bit;
+  }
+  void push_back(bool value) {
+    if (m_size % 64 == 0)
+      m_words.push_back(0);
+    ++m_size;
+    set(m_size - 1, value);
+  }
+  void reserve(std::size_t size) {
+    m_words.reserve((size + 63) / 64);
+  }
+
+  /// @brief The number of set bits.
+  std::size_t count() const noexcept {
+    std::size_t result = 0;
+    for (auto word : m_words)
+      result += static_cast<std::size_t>(std::popcount(word));
+    return result;
+  }
+
+  bitmap &operator&=(const bitmap &other) noexcept {
+    for (std::size_t i = 0; i != m_words.size(); ++i)
+      m_words[i] &= other.m_words[i];
+    return *this;
+  }
+  bitmap &operator|=(const bitmap &other) noexcept {
+    for (std::size_t i = 0; i != m_words.size(); ++i)
+      m_words[i] |= other.m_words[i];
+    return *this;
+  }
+  friend bitmap operator&(bitmap lhs, const bitmap &rhs) noexcept {
+    return lhs &= rhs;
+  }
+  friend bitmap operator|(bitmap lhs, const bitmap &rhs) noexcept {
+    return lhs |= rhs;
+  }
+
+  /// @brief Bit i is bit i % 64 of word i / 64; bits past size() are 0.
+  std::span<const std::uint64_t> words() const noexcept {
+    return m_words;
+  }
+  std::span<std::uint64_t> words() noexcept {
+    return m_words;
+  }
+
+ private:
+  void clear_tail() noexcept {
+    if (m_size % 64 != 0)
+      m_words.back() &= (std::uint64_t{1} << (m_size % 64)) - 1;
+  }
+
+  std::vector<std::uint64_t> m_words;
+  std::size_t m_size = 0;
+};
+
+struct integer_column {
+  std::vector<int> values;
+  bitmap valid;
+
+  std::size_t size() const noexcept {
+    return values.size();
+  }
+};
+
+struct boolean_column {
+  bitmap values;
+  bitmap valid;
+
+  std::size_t size() const noexcept {
+    return values.size();
+  }
+};
+
+/// @brief String i is bytes[offsets[i], offsets[i + 1]).
+struct string_column {
+  std::vector<std::size_t> offsets{0};
+  std::string bytes;
+  bitmap valid;
+
+  std::size_t size() const noexcept {
+    return offsets.size() - 1;
+  }
+  std::string_view operator[](std::size_t i) const noexcept {
+    return std::string_view{bytes}.substr(offsets[i],
+                                          offsets[i + 1] - offsets[i]);
+  }
+};
+
+using column = std::variant<integer_column, string_column, boolean_column>;
+
+namespace detail {
+  class table_builder;
+} // namespace detail
+
+class table {
+ public:
+  std::size_t rows() const noexcept {
+    return m_rows;
+  }
+  std::size_t column_count() const noexcept {
+    return m_columns.size();
+  }
+  std::string_view name(std::size_t i) const noexcept {
+    return m_names[i];
+  }
+  const column &operator[](std::size_t i) const noexcept {
+    return m_columns[i];
+  }
+
+  /// @return nullptr if there is no such column.
+  const column *find(std::string_view name) const noexcept {
+    for (std::size_t i = 0; i != m_names.size(); ++i)
+      if (m_names[i] == name)
+        return &m_columns[i];
+    return nullptr;
+  }
+
+  /// @throws std::out_of_range if there is no such column, and
+  /// std::bad_variant_access if it has another type.
+  template <typename Column>
+  const Column &get(std::string_view name) const {
+    auto result = find(name);
+    if (!result)
+      throw std::out_of_range("no column named " + std::string(name));
+    return std::get<Column>(*result);
+  }
+
+ private:
+  friend class detail::table_builder;
+
+  std::size_t m_rows = 0;
+  std::vector<std::string> m_names;
+  std::vector<column> m_columns;
+};
+
+namespace detail {
+
+  inline constexpr auto no_column = std::numeric_limits<std::size_t>::max();
+
+  // The column type for values of kind k, or none.
+  inline bool make_column(dom::Kind k, column &result) {
+    switch (k) {
+    case dom::Kind::Integer:
+      result = integer_column{};
+      return true;
+    case dom::Kind::String:
+      result = string_column{};
+      return true;
+    case dom::Kind::True:
+    case dom::Kind::False:
+      result = boolean_column{};
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  template <CValue Node>
+  consteval dom::Kind sample_kind() {
+    constexpr auto kind = dom::kind_of<Node>;
+    static_assert(kind == dom::Kind::Integer || kind == dom::Kind::String ||
+                      kind == dom::Kind::True || kind == dom::Kind::False,
+                  "a column must hold integers, strings or booleans");
+    return kind;
+  }
+
+  // The record described by a sample: an Object, or the first element of an
+  // Array of them.
+  template <CValue Sample>
+  struct sample_record {
+    static_assert(meta::is_specialization_of_v<Sample, Object>,
+                  "a sample must be an Object or an Array of Objects");
+    using type = Sample;
+  };
+
+  template <CValue First, CValue... Rest>
+  struct sample_record<Array<First, Rest...>> : sample_record<First> {};
+
+  class table_builder {
+   public:
+    explicit table_builder(bool infer) noexcept : m_infer{infer} {}
+
+    void add_column(std::string_view name, dom::Kind kind) {
+      column result;
+      if (!make_column(kind, result))
+        return;
+      std::visit([&](auto &c) { pad(c, m_table.m_rows); }, result);
+      m_table.m_names.emplace_back(name);
+      m_table.m_columns.push_back(std::move(result));
+    }
+
+    table convert(const dom::Array &rows) {
+      for (auto &c : m_table.m_columns)
+        std::visit([&](auto &c) { reserve(c, rows.size()); }, c);
+      for (const auto &row : rows) {
+        if (row.is_object())
+          append(row.as_object());
+        ++m_table.m_rows;
+        for (auto &c : m_table.m_columns)
+          std::visit([&](auto &c) { pad(c, m_table.m_rows); }, c);
+      }
+      return std::move(m_table);
+    }
+
+   private:
+    void append(const dom::Object &row) {
+      if (!m_last || !row.same_shape(*m_last)) {
+        m_member_column.assign(row.size(), no_column);
+        for (std::size_t i = 0; i != row.size(); ++i)
+          for (std::size_t c = 0; c != m_table.m_names.size(); ++c)
+            if (m_table.m_names[c] == row.key(i))
+              m_member_column[i] = c;
+      }
+      m_last = &row;
+      for (std::size_t i = 0; i != row.size(); ++i) {
+        auto c = m_member_column[i];
+        if (c == no_column) {
+          // Only a key without a column yet in any previous row can get one.
+          if (!m_infer || m_table.find(row.key(i)))
+            continue;
+          auto count = m_table.m_columns.size();
+          add_column(row.key(i), row.value(i).kind());
+          if (m_table.m_columns.size() == count)
+            continue;
+          c = m_member_column[i] = count;
+        }
+        std::visit([&](auto &column) { push(column, row.value(i)); },
+                   m_table.m_columns[c]);
+      }
+    }
+
+    static void reserve(integer_column &c, std::size_t n) {
+      c.values.reserve(n);
+      c.valid.reserve(n);
+    }
+    static void reserve(boolean_column &c, std::size_t n) {
+      c.values.reserve(n);
+      c.valid.reserve(n);
+    }
+    static void reserve(string_column &c, std::size_t n) {
+      c.offsets.reserve(n + 1);
+      c.valid.reserve(n);
+    }
+
+    static void push(integer_column &c, const dom::Value &v) {
+      if (v.is_integer()) {
+        c.values.push_back(v.as_integer());
+        c.valid.push_back(true);
+      }
+    }
+    static void push(boolean_column &c, const dom::Value &v) {
+      if (v.is_bool()) {
+        c.values.push_back(v.as_bool());
+        c.valid.push_back(true);
+      }
+    }
+    static void push(string_column &c, const dom::Value &v) {
+      if (v.is_string()) {
+        c.bytes += v.as_string();
+        c.offsets.push_back(c.bytes.size());
+        c.valid.push_back(true);
+      }
+    }
+
+    // Fills the column with invalid entries up to `rows`.
+    static void pad(integer_column &c, std::size_t rows) {
+      while (c.size() < rows) {
+        c.values.push_back(0);
+        c.valid.push_back(false);
+      }
+    }
+    static void pad(boolean_column &c, std::size_t rows) {
+      while (c.size() < rows) {
+        c.values.push_back(false);
+        c.valid.push_back(false);
+      }
+    }
+    static void pad(string_column &c, std::size_t rows) {
+      while (c.size() < rows) {
+        c.offsets.push_back(c.offsets.back());
+        c.valid.push_back(false);
+      }
+    }
+
+    table m_table;
+    bool m_infer;
+    const dom::Object *m_last = nullptr;
+    std::vector<std::size_t> m_member_column; // for the shape of m_last
+  };
+
+} // namespace detail
+
+/// @brief Converts an array of objects, with a column for every key whose
+/// first non-null value is an integer, a string or a boolean, in the order
+/// the keys are met.
+inline table from_array(const dom::Array &rows) {
+  return detail::table_builder{true}.convert(rows);
+}
+
+/// @brief Converts an array of objects into the columns of a sample record,
+/// given as a ctjson Object (or an Array whose first element is one). Other
+/// keys are ignored.
+template <CValue Sample>
+inline table from_array(const dom::Array &rows) {
+  detail::table_builder builder{false};
+  [&]<CMember... Members>(Object<Members...>) {
+    (builder.add_column(Members::key.to_string_view(),
+                        detail::sample_kind<typename Members::value>()),
+     ...);
+  }(typename detail::sample_record<Sample>::type{});
+  return builder.convert(rows);
+}
+
+// Kernels. They process 64 rows per bitmap word with fixed-length,
+// branch-free inner loops, which compilers vectorize.
+
+namespace detail {
+
+  // Calls f(word_index, first_row, rows) for every word of a bitmap of size
+  // rows, with rows == 64 as a constant for all but the last word.
+  template <typename F>
+  void for_each_word(std::size_t size, F f) {
+    auto full = size / 64;
+    for (std::size_t w = 0; w != full; ++w)
+      f(w, w * 64, std::integral_constant<std::size_t, 64>{});
+    if (size % 64 != 0)
+      f(full, full * 64, size % 64);
+  }
+
+} // namespace detail
+
+/// @brief The rows whose valid values satisfy pred(value).
+template <typename Pred>
+bitmap select(const integer_column &c, Pred pred) {
+  bitmap result(c.size());
+  auto words = result.words();
+  detail::for_each_word(c.size(), [&](std::size_t w, std::size_t base,
+                                      auto rows) {
+    std::uint64_t word = 0;
+    for (std::size_t j = 0; j != rows; ++j)
+      word |= static_cast<std::uint64_t>(pred(c.values[base + j]) ? 1 : 0)
+              << j;
+    words[w] = word;
+  });
+  return result &= c.valid;
+}
+
+/// @brief The rows whose valid values satisfy pred(std::string_view).
+template <typename Pred>
+bitmap select(const string_column &c, Pred pred) {
+  bitmap result(c.size());
+  for (std::size_t i = 0; i != c.size(); ++i)
+    if (pred(c[i]))
+      result.set(i);
+  return result &= c.valid;
+}
+
+/// @brief The rows whose valid values are true.
+inline bitmap select(const boolean_column &c) {
+  return c.values & c.valid;
+}
+
+/// @brief The sum of the valid values, only in the selected rows if given.
+inline long long sum(const integer_column &c,
+                     const bitmap *selection = nullptr) {
+  long long result = 0;
+  if (!selection) {
+    // Invalid entries are 0.
+    for (auto v : c.values)
+      result += v;
+    return result;
+  }
+  auto words = selection->words();
+  detail::for_each_word(c.size(), [&](std::size_t w, std::size_t base,
+                                      auto rows) {
+    auto word = words[w];
+    for (std::size_t j = 0; j != rows; ++j)
+      result += c.values[base + j] &
+                -static_cast<int>((word >> j) & 1);
+  });
+  return result;
+}
+
+} // namespace gkxx::ctjson::columnar
+
+#endif // GKXX_CTJSON_COLUMNAR_HPP
@@ -0,0 +1,912 @@
+#ifndef GKXX_CTJSON_DOM_HPP
+#define GKXX_CTJSON_DOM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ctjson.hpp"
+#include "instrument.hpp"
+
+// Runtime counterpart of the node types in ctjson.hpp, accepting exactly the
+// same grammar and tokens. Containers and strings allocate from a
+// std::pmr::memory_resource, so a whole document can be built in an arena.
+
+namespace gkxx::ctjson::dom {
+
+enum class Kind : unsigned char {
+  Integer,
+  String,
+  True,
+  False,
+  Null,
+  Object,
+  Array
+};
+
+class Value;
+class Object;
+class ObjectBuilder;
+class key_table;
+
+using Array = std::pmr::vector<Value>;
+
+/// @brief Identifies a key within the key_table of a document.
+using key_id = std::uint32_t;
+
+namespace detail {
+
+  class Parser;
+
+  // The keys shared by all the objects with the same keys in the same order,
+  // like the hidden classes of JavaScript engines.
+  struct shape {
+    key_table *table;
+    std::pmr::vector<key_id> ids;
+    std::pmr::vector<std::string_view> keys;
+  };
+
+} // namespace detail
+
+/// @brief A member of an Object, as seen when iterating over it.
+struct Member {
+  std::string_view key;
+  const Value &value;
+};
+
+/// @brief The members of an object, in order. The keys live in the key_table
+/// of the document and are shared through the shape of the object, so an
+/// object only stores its values. A copy keeps its keys in the same resource as
+/// its values, so it does not depend on the document it was copied from.
+class Object {
+ public:
+  class iterator {
+   public:
+    using value_type = Member;
+    using reference = Member;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() noexcept = default;
+    Member operator*() const;
+    iterator &operator++() noexcept {
+      ++m_index;
+      return *this;
+    }
+    iterator operator++(int) noexcept {
+      auto old = *this;
+      ++m_index;
+      return old;
+    }
+    friend bool operator==(const iterator &, const iterator &) = default;
+
+   private:
+    friend class Object;
+    iterator(const Object *object, std::size_t index) noexcept
+        : m_object{object}, m_index{index} {}
+
+    const Object *m_object = nullptr;
+    std::size_t m_index = 0;
+  };
+
+  Object() noexcept = default;
+  Object(const Object &other);
+  Object(Object &&other) noexcept;
+  Object &operator=(Object other);
+  ~Object();
+
+  std::size_t size() const noexcept;
+  bool empty() const noexcept;
+  std::string_view key(std::size_t i) const noexcept {
+    return m_shape->keys[i];
+  }
+  key_id id(std::size_t i) const noexcept {
+    return m_shape->ids[i];
+  }
+  const Value &value(std::size_t i) const noexcept;
+  Value &value(std::size_t i) noexcept;
+  Member operator[](std::size_t i) const noexcept;
+  iterator begin() const noexcept {
+    return {this, 0};
+  }
+  iterator end() const noexcept {
+    return {this, size()};
+  }
+
+  /// @return nullptr if there is no such member.
+  const Value *find(std::string_view key) const noexcept;
+  /// @brief Looks a member up by an id from keys(), comparing integers only.
+  const Value *find(key_id id) const noexcept;
+
+  /// @brief Whether both objects share a shape, which implies the same keys in
+  /// the same order. Objects with different key tables never do.
+  bool same_shape(const Object &other) const noexcept {
+    return m_shape == other.m_shape;
+  }
+
+  /// @brief The key table of the document, or nullptr for an empty object.
+  const key_table *keys() const noexcept {
+    return m_shape ? m_shape->table : nullptr;
+  }
+
+ private:
+  friend class ObjectBuilder;
+  friend class detail::Parser;
+  Object(const detail::shape *shape, Array values) noexcept;
+
+  const detail::shape *m_shape = nullptr;
+  Array m_values;
+};
+
+class Value {
+ public:
+  Value() = default;
+  Value(std::nullptr_t) noexcept {}
+  Value(bool b) noexcept : m_kind{b ? Kind::True : Kind::False} {}
+  Value(int n) noexcept : m_kind{Kind::Integer}, m_data{n} {}
+  Value(std::pmr::string s) : m_kind{Kind::String}, m_data{std::move(s)} {}
+  Value(std::string_view s) : Value(std::pmr::string(s)) {}
+  Value(const char *s) : Value(std::pmr::string(s)) {}
+  Value(Array a) : m_kind{Kind::Array}, m_data{std::move(a)} {}
+  Value(Object o) : m_kind{Kind::Object}, m_data{std::move(o)} {}
+
+  Kind kind() const noexcept {
+    return m_kind;
+  }
+  bool is_integer() const noexcept {
+    return m_kind == Kind::Integer;
+  }
+  bool is_string() const noexcept {
+    return m_kind == Kind::String;
+  }
+  bool is_bool() const noexcept {
+    return m_kind == Kind::True || m_kind == Kind::False;
+  }
+  bool is_null() const noexcept {
+    return m_kind == Kind::Null;
+  }
+  bool is_object() const noexcept {
+    return m_kind == Kind::Object;
+  }
+  bool is_array() const noexcept {
+    return m_kind == Kind::Array;
+  }
+
+  int as_integer() const {
+    return std::get<int>(m_data);
+  }
+  bool as_bool() const {
+    if (!is_bool())
+      throw std::bad_variant_access{};
+    return m_kind == Kind::True;
+  }
+  const std::pmr::string &as_string() const {
+    return std::get<std::pmr::string>(m_data);
+  }
+  const Array &as_array() const {
+    return std::get<Array>(m_data);
+  }
+  Array &as_array() {
+    return std::get<Array>(m_data);
+  }
+  const Object &as_object() const {
+    return std::get<Object>(m_data);
+  }
+  Object &as_object() {
+    return std::get<Object>(m_data);
+  }
+
+  /// @brief Looks up a member of an object.
+  /// @return nullptr if this is not an object or has no such member.
+  const Value *find(std::string_view key) const noexcept {
+    return is_object() ? std::get<Object>(m_data).find(key) : nullptr;
+  }
+
+ private:
+  Kind m_kind{Kind::Null};
+  std::variant<std::monostate, int, std::pmr::string, Array, Object> m_data;
+};
+
+/// @brief The keys of a document and the shapes of its objects. It is shared
+/// by the objects and freed with the last of them. Interning new keys or
+/// shapes does not change existing ones, so a table may be extended through a
+/// const reference, but not by two threads at once.
+class key_table {
+ public:
+  key_table(const key_table &) = delete;
+  key_table &operator=(const key_table &) = delete;
+
+  std::size_t size() const noexcept {
+    return m_names.size();
+  }
+  std::size_t shape_count() const noexcept {
+    return m_shapes.size();
+  }
+  std::optional<key_id> find(std::string_view key) const {
+    if (auto it = m_ids.find(key); it != m_ids.end())
+      return it->second;
+    return std::nullopt;
+  }
+  std::string_view name(key_id id) const noexcept {
+    return m_names[id];
+  }
+
+ private:
+  friend class Object;
+  friend class ObjectBuilder;
+  friend class detail::Parser;
+
+  explicit key_table(std::pmr::memory_resource *resource)
+      : m_resource{resource}, m_names(resource), m_ids(resource),
+        m_shapes(resource), m_shape_index(resource) {}
+
+  static const key_table *create(std::pmr::memory_resource *resource) {
+    auto memory = resource->allocate(sizeof(key_table), alignof(key_table));
+    return ::new (memory) key_table(resource);
+  }
+
+  void add_ref() const noexcept {
+    m_refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  void release() const noexcept {
+    if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      auto resource = m_resource;
+      this->~key_table();
+      resource->deallocate(const_cast<key_table *>(this), sizeof(key_table),
+                           alignof(key_table));
+    }
+  }
+
+  // A shape with the keys of `shape` in a table allocated from `resource`:
+  // `shape` itself if its table already is, or else the same shape in a new
+  // table, so that a copy never refers to the memory of another document.
+  static const detail::shape *shape_in(const detail::shape &shape,
+                                       std::pmr::memory_resource *resource) {
+    if (shape.table->m_resource == resource) {
+      shape.table->add_ref();
+      return &shape;
+    }
+    auto table = create(resource);
+    try {
+      std::vector<key_id> ids;
+      ids.reserve(shape.keys.size());
+      for (auto key : shape.keys)
+        ids.push_back(table->intern(key));
+      return table->shape_of(ids);
+    } catch (...) {
+      table->release();
+      throw;
+    }
+  }
+
+  key_id intern(std::string_view key) const {
+    if (auto it = m_ids.find(key); it != m_ids.end())
+      return it->second;
+    auto id = static_cast<key_id>(m_names.size());
+    m_ids.emplace(m_names.emplace_back(key), id);
+    return id;
+  }
+
+  const detail::shape *shape_of(std::span<const key_id> ids) const {
+    auto hash = std::hash<std::string_view>{}(
+        {reinterpret_cast<const char *>(ids.data()), ids.size_bytes()});
+    auto [first, last] = m_shape_index.equal_range(hash);
+    for (auto it = first; it != last; ++it)
+      if (std::ranges::equal(it->second->ids, ids))
+        return it->second;
+    auto &shape = m_shapes.emplace_back(
+        detail::shape{const_cast<key_table *>(this),
+                      std::pmr::vector<key_id>(ids.begin(), ids.end(),
+                                               m_resource),
+                      std::pmr::vector<std::string_view>(m_resource)});
+    for (auto id : ids)
+      shape.keys.push_back(m_names[id]);
+    m_shape_index.emplace(hash, &shape);
+    return &shape;
+  }
+
+  std::pmr::memory_resource *m_resource;
+  mutable std::atomic<std::size_t> m_refs{1};
+  mutable std::pmr::deque<std::pmr::string> m_names;
+  mutable std::pmr::unordered_map<std::string_view, key_id> m_ids;
+  mutable std::pmr::deque<detail::shape> m_shapes;
+  mutable std::pmr::unordered_multimap<std::size_t, const detail::shape *>
+      m_shape_index;
+};
+
+inline Object::Object(const detail::shape *shape, Array values) noexcept
+    : m_shape{shape}, m_values(std::move(values)) {
+  m_shape->table->add_ref();
+}
+
+// The values are copied onto the default resource, as pmr containers do, and
+// the keys follow them there unless they already live there.
+inline Object::Object(const Object &other) : m_values(other.m_values) {
+  if (other.m_shape)
+    m_shape = key_table::shape_in(*other.m_shape,
+                                  m_values.get_allocator().resource());
+}
+
+inline Object::Object(Object &&other) noexcept
+    : m_shape{std::exchange(other.m_shape, nullptr)},
+      m_values(std::move(other.m_values)) {}
+
+inline Object &Object::operator=(Object other) {
+  if (m_values.get_allocator() == other.m_values.get_allocator()) {
+    std::swap(m_shape, other.m_shape);
+    m_values.swap(other.m_values);
+    return *this;
+  }
+  // Containers with unequal allocators must not be swapped: copy the values
+  // into our resource, and the keys along with them.
+  Array values(m_values.get_allocator());
+  values.reserve(other.size());
+  for (const auto &value : other.m_values)
+    values.push_back(value);
+  auto shape = other.m_shape
+                   ? key_table::shape_in(*other.m_shape,
+                                         values.get_allocator().resource())
+                   : nullptr;
+  m_values.swap(values);
+  std::swap(m_shape, shape);
+  if (shape)
+    shape->table->release();
+  return *this;
+}
+
+inline Object::~Object() {
+  if (m_shape)
+    m_shape->table->release();
+}
+
+inline std::size_t Object::size() const noexcept {
+  return m_values.size();
+}
+
+inline bool Object::empty() const noexcept {
+  return m_values.empty();
+}
+
+inline const Value &Object::value(std::size_t i) const noexcept {
+  return m_values[i];
+}
+
+inline Value &Object::value(std::size_t i) noexcept {
+  return m_values[i];
+}
+
+inline Member Object::operator[](std::size_t i) const noexcept {
+  return {key(i), m_values[i]};
+}
+
+inline Member Object::iterator::operator*() const {
+  return (*m_object)[m_index];
+}
+
+inline const Value *Object::find(std::string_view key) const noexcept {
+  for (std::size_t i = 0; i != size(); ++i)
+    if (m_shape->keys[i] == key)
+      return &m_values[i];
+  return nullptr;
+}
+
+inline const Value *Object::find(key_id id) const noexcept {
+  for (std::size_t i = 0; i != size(); ++i)
+    if (m_shape->ids[i] == id)
+      return &m_values[i];
+  return nullptr;
+}
+
+/// @brief Builds objects whose keys are interned in one key_table.
+class ObjectBuilder {
+ public:
+  /// @brief Interns keys in a new table.
+  explicit ObjectBuilder(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : m_table{key_table::create(resource)}, m_values(resource) {}
+
+  /// @brief Interns keys in the table of `like`, or in a new table if it is
+  /// empty.
+  explicit ObjectBuilder(
+      const Object &like,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : m_table{like.keys()}, m_values(resource) {
+    if (m_table)
+      m_table->add_ref();
+    else
+      m_table = key_table::create(resource);
+  }
+
+  ObjectBuilder(const ObjectBuilder &) = delete;
+  ObjectBuilder &operator=(const ObjectBuilder &) = delete;
+  ~ObjectBuilder() {
+    m_table->release();
+  }
+
+  /// @return false, adding nothing, if the object already has the key.
+  bool add(std::string_view key, Value value) {
+    auto id = m_table->intern(key);
+    if (std::ranges::find(m_ids, id) != m_ids.end())
+      return false;
+    m_ids.push_back(id);
+    m_values.push_back(std::move(value));
+    return true;
+  }
+
+  /// @brief The object built so far; the builder starts a new one.
+  Object finish() {
+    auto values = std::exchange(m_values, Array(m_values.get_allocator()));
+    if (values.empty())
+      return Object{};
+    auto shape = m_table->shape_of(m_ids);
+    m_ids.clear();
+    return Object{shape, std::move(values)};
+  }
+
+  const key_table &keys() const noexcept {
+    return *m_table;
+  }
+
+ private:
+  const key_table *m_table;
+  std::vector<key_id> m_ids;
+  Array m_values;
+};
+
+/// @brief Thrown by the runtime parser. The message is the same as the one the
+/// compile-time parser reports, but the position is a byte offset.
+class parse_error : public std::runtime_error {
+ public:
+  parse_error(const std::string &message, std::size_t position)
+      : std::runtime_error(message + " at index " + std::to_string(position)),
+        m_message{message}, m_position{position} {}
+  const std::string &message() const noexcept {
+    return m_message;
+  }
+  std::size_t position() const noexcept {
+    return m_position;
+  }
+
+ private:
+  std::string m_message;
+  std::size_t m_position;
+};
+
+/// @brief How deeply objects and arrays may nest before the parsers throw
+/// parse_error("too deep"), instead of running out of stack.
+inline constexpr std::size_t default_max_depth = 512;
+
+namespace detail {
+
+  // Reads the token starting at src[pos] with the lexer DFA, throwing the
+  // error it meets.
+  inline lex::lexeme lex_token(std::string_view src, std::size_t pos) {
+    auto lexeme = lex::scan(src, pos);
+    if (lexeme.kind == lex::token_kind::Error)
+      throw parse_error(std::string(lexeme.error), lexeme.error_position);
+    return lexeme;
+  }
+
+  // Appends the contents of the string starting at the quote src[pos] to
+  // `contents`, leaving pos after the closing quote.
+  template <typename String>
+  inline void lex_string(std::string_view src, std::size_t &pos,
+                         String &contents) {
+    auto lexeme = lex_token(src, pos);
+    if (lexeme.escapes == 0)
+      contents.append(src.data() + lexeme.begin + 1,
+                      lexeme.end - lexeme.begin - 2);
+    else
+      lex::append_contents(src, lexeme.begin, lexeme.end, contents);
+    pos = lexeme.end;
+  }
+
+  // Reads the integer starting at src[pos], leaving pos after its last digit.
+  inline int lex_integer(std::string_view src, std::size_t &pos) {
+    auto lexeme = lex_token(src, pos);
+    auto checked = lex::check_integer(src, pos, lexeme.end);
+    if (!checked.error.empty())
+      throw parse_error(std::string(checked.error), checked.error_position);
+    pos = lexeme.end;
+    return checked.value;
+  }
+
+  // Byte range of a value, relative to the beginning of its parent, and the
+  // ranges of its elements or member values.
+  struct value_span {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::vector<value_span> children;
+  };
+
+  class Parser {
+   public:
+    /// @param spans If not null, the span of every value parsed at the top
+    /// level is appended to spans->children, relative to `spans_begin`.
+    Parser(std::string_view src, std::pmr::memory_resource *resource,
+           value_span *spans = nullptr, std::size_t spans_begin = 0) noexcept
+        : m_src{src}, m_resource{resource}, m_span{spans},
+          m_span_begin{spans_begin} {}
+
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+    ~Parser() {
+      if (m_keys)
+        m_keys->release();
+    }
+
+    /// @brief Interns the keys of the objects parsed from now on in `keys`.
+    void use_keys(const key_table &keys) noexcept {
+      keys.add_ref();
+      if (m_keys)
+        m_keys->release();
+      m_keys = &keys;
+    }
+
+    /// @brief Objects and arrays nested deeper than `depth` throw
+    /// parse_error("too deep") at their opening bracket.
+    void set_max_depth(std::size_t depth) noexcept {
+      m_max_depth = depth;
+    }
+
+    /// @brief Starts over on another source, keeping the key table.
+    void reset(std::string_view src) noexcept {
+      m_src = src;
+      m_pos = 0;
+    }
+
+    Value parse_document() {
+      GKXX_CTJSON_INSTRUMENTED(
+          instrument::document_scope document{m_src.size(), m_resource};
+          m_stats = {};)
+      skip_whitespace();
+      auto root = parse_value();
+      skip_whitespace();
+      if (m_pos != m_src.size())
+        fail("expects end of string");
+      GKXX_CTJSON_INSTRUMENTED(document.finish(m_stats);)
+      return root;
+    }
+
+    /// @brief Parses the value starting exactly at pos and moves pos past it.
+    /// @param depth The number of containers the value is nested in.
+    Value parse_value_at(std::size_t &pos, std::size_t depth = 0) {
+      m_pos = pos;
+      m_depth = depth;
+      auto value = parse_value();
+      pos = m_pos;
+      return value;
+    }
+
+#if GKXX_CTJSON_INSTRUMENT
+    /// @brief What has been parsed since the last parse_document() began.
+    const instrument::parse_stats &stats() const noexcept {
+      return m_stats;
+    }
+#endif
+
+   private:
+    [[noreturn]] void fail(const char *message) const {
+      throw parse_error(message, m_pos);
+    }
+
+    void skip_whitespace() noexcept {
+      while (m_pos < m_src.size() && is_whitespace(m_src[m_pos]))
+        ++m_pos;
+    }
+
+    // Counts the container whose bracket is at pos for as long as it lives.
+    class nesting {
+     public:
+      explicit nesting(Parser &parser) : m_parser{parser} {
+        if (parser.m_depth == parser.m_max_depth)
+          parser.fail("too deep");
+        ++parser.m_depth;
+        GKXX_CTJSON_INSTRUMENTED(parser.m_stats.max_depth = std::max(
+                                     parser.m_stats.max_depth, parser.m_depth);)
+      }
+      nesting(const nesting &) = delete;
+      nesting &operator=(const nesting &) = delete;
+      ~nesting() {
+        --m_parser.m_depth;
+      }
+
+     private:
+      Parser &m_parser;
+    };
+
+    bool consume(char c) noexcept {
+      if (m_pos < m_src.size() && m_src[m_pos] == c) {
+        ++m_pos;
+        return true;
+      }
+      return false;
+    }
+
+    void expect_keyword() {
+      m_pos = lex_token(m_src, m_pos).end;
+    }
+
+    Value parse_value() {
+      if (m_span)
+        return parse_value_with_span();
+      return parse_value_only();
+    }
+
+    Value parse_value_with_span() {
+      auto parent = m_span;
+      auto parent_begin = m_span_begin;
+      auto &span = parent->children.emplace_back();
+      span.begin = m_pos - parent_begin;
+      m_span = &span;
+      m_span_begin = m_pos;
+      auto value = parse_value_only();
+      m_span = parent;
+      m_span_begin = parent_begin;
+      span.end = m_pos - parent_begin;
+      return value;
+    }
+
+    Value parse_value_only() {
+      if (m_pos == m_src.size())
+        fail("expects Value");
+      switch (m_src[m_pos]) {
+      case '{':
+        GKXX_CTJSON_INSTRUMENTED(count(Kind::Object);)
+        return parse_object();
+      case '[':
+        GKXX_CTJSON_INSTRUMENTED(count(Kind::Array);)
+        return parse_array();
+      case '"':
+        GKXX_CTJSON_INSTRUMENTED(count(Kind::String);)
+        return parse_string();
+      case 't':
+        expect_keyword();
+        GKXX_CTJSON_INSTRUMENTED(count(Kind::True);)
+        return true;
+      case 'f':
+        expect_keyword();
+        GKXX_CTJSON_INSTRUMENTED(count(Kind::False);)
+        return false;
+      case 'n':
+        expect_keyword();
+        GKXX_CTJSON_INSTRUMENTED(count(Kind::Null);)
+        return nullptr;
+      default:
+        if (m_src[m_pos] == '-' || is_digit(m_src[m_pos])) {
+          GKXX_CTJSON_INSTRUMENTED(count(Kind::Integer);)
+          return parse_integer();
+        }
+        if (std::string_view{"}],:"}.find(m_src[m_pos]) != std::string_view::npos)
+          fail("expects Value");
+        fail("Unrecognized token");
+      }
+    }
+
+    Value parse_object() {
+      nesting nested{*this};
+      ++m_pos; // '{'
+      skip_whitespace();
+      if (consume('}'))
+        return Object{};
+      auto &keys = this->keys();
+      auto first_id = m_key_ids.size();
+      Array values(m_resource);
+      while (true) {
+        skip_whitespace();
+        if (m_pos == m_src.size() || m_src[m_pos] != '"')
+          fail("expects String");
+        auto key_pos = m_pos;
+        m_key.clear();
+        lex_string(m_src, m_pos, m_key);
+        GKXX_CTJSON_INSTRUMENTED(m_stats.string_bytes += m_key.size();)
+        auto id = keys.intern(m_key);
+        if (std::find(m_key_ids.begin() + static_cast<std::ptrdiff_t>(first_id),
+                      m_key_ids.end(), id) != m_key_ids.end()) {
+          m_pos = key_pos;
+          fail("duplicate object key");
+        }
+        m_key_ids.push_back(id);
+        skip_whitespace();
+        if (!consume(':'))
+          fail("expects ':'");
+        skip_whitespace();
+        values.push_back(parse_value());
+        skip_whitespace();
+        if (consume('}')) {
+          auto shape = keys.shape_of(
+              std::span{m_key_ids}.subspan(first_id));
+          m_key_ids.resize(first_id);
+          return Object{shape, std::move(values)};
+        }
+        if (!consume(','))
+          fail("expects '}'");
+      }
+    }
+
+    Value parse_array() {
+      nesting nested{*this};
+      ++m_pos; // '['
+      Array values(m_resource);
+      skip_whitespace();
+      if (consume(']'))
+        return values;
+      while (true) {
+        skip_whitespace();
+        values.push_back(parse_value());
+        skip_whitespace();
+        if (consume(']'))
+          return values;
+        if (!consume(','))
+          fail("expects ']'");
+      }
+    }
+
+    Value parse_string() {
+      return parse_string_contents();
+    }
+
+    std::pmr::string parse_string_contents() {
+      std::pmr::string contents(m_resource);
+      lex_string(m_src, m_pos, contents);
+      GKXX_CTJSON_INSTRUMENTED(m_stats.string_bytes += contents.size();)
+      return contents;
+    }
+
+    Value parse_integer() {
+      return lex_integer(m_src, m_pos);
+    }
+
+    // Created by the first object, so that documents without objects do not
+    // pay for it.
+    const key_table &keys() {
+      if (!m_keys)
+        m_keys = key_table::create(m_resource);
+      return *m_keys;
+    }
+
+#if GKXX_CTJSON_INSTRUMENT
+    void count(Kind kind) noexcept {
+      ++m_stats.nodes[static_cast<std::size_t>(kind)];
+    }
+#endif
+
+    std::string_view m_src;
+    std::pmr::memory_resource *m_resource;
+    value_span *m_span;
+    std::size_t m_span_begin;
+    std::size_t m_pos = 0;
+    std::size_t m_depth = 0;
+    std::size_t m_max_depth = default_max_depth;
+    const key_table *m_keys = nullptr;
+    std::vector<key_id> m_key_ids; // of the objects being parsed
+    std::string m_key;
+    GKXX_CTJSON_INSTRUMENTED(instrument::parse_stats m_stats;)
+  };
+
+} // namespace detail
+
+/// @brief Parses src into a DOM, throwing parse_error on failure. All memory of
+/// the DOM is allocated from `resource`.
+inline Value
+parse(std::string_view src,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      std::size_t max_depth = default_max_depth) {
+  detail::Parser parser{src, resource};
+  parser.set_max_depth(max_depth);
+  return parser.parse_document();
+}
+
+namespace detail {
+
+  template <CValue Node>
+  struct node_traits;
+
+  template <int N>
+  struct node_traits<ctjson::Integer<N>> {
+    static constexpr auto kind = Kind::Integer;
+    static Value make() {
+      return N;
+    }
+    static bool equals(const Value &v) noexcept {
+      return v.is_integer() && v.as_integer() == N;
+    }
+  };
+
+  template <fixed_string S>
+  struct node_traits<ctjson::String<S>> {
+    static constexpr auto kind = Kind::String;
+    static Value make() {
+      return S.to_string_view();
+    }
+    static bool equals(const Value &v) noexcept {
+      return v.is_string() && v.as_string() == S.to_string_view();
+    }
+  };
+
+  template <fixed_string S>
+  struct node_traits<KeywordToken<S>> {
+    static constexpr auto kind =
+        std::is_same_v<KeywordToken<S>, True>    ? Kind::True
+        : std::is_same_v<KeywordToken<S>, False> ? Kind::False
+                                                 : Kind::Null;
+    static Value make() {
+      if constexpr (kind == Kind::Null)
+        return nullptr;
+      else
+        return kind == Kind::True;
+    }
+    static bool equals(const Value &v) noexcept {
+      return v.kind() == kind;
+    }
+  };
+
+  template <CValue... Values>
+  struct node_traits<ctjson::Array<Values...>> {
+    static constexpr auto kind = Kind::Array;
+    static Value make() {
+      return Array{node_traits<Values>::make()...};
+    }
+    static bool equals(const Value &v) noexcept {
+      if (!v.is_array() || v.as_array().size() != sizeof...(Values))
+        return false;
+      std::size_t i = 0;
+      return (node_traits<Values>::equals(v.as_array()[i++]) && ...);
+    }
+  };
+
+  template <CMember... Members>
+  struct node_traits<ctjson::Object<Members...>> {
+    static constexpr auto kind = Kind::Object;
+    static Value make() {
+      ObjectBuilder builder;
+      (builder.add(Members::key.to_string_view(),
+                   node_traits<typename Members::value>::make()),
+       ...);
+      return builder.finish();
+    }
+    static bool equals(const Value &v) noexcept {
+      if (!v.is_object() || v.as_object().size() != sizeof...(Members))
+        return false;
+      return ([&] {
+        auto member = v.find(Members::key.to_string_view());
+        return member &&
+               node_traits<typename Members::value>::equals(*member);
+      }() && ...);
+    }
+  };
+
+} // namespace detail
+
+template <CValue Node>
+inline constexpr Kind kind_of = detail::node_traits<Node>::kind;
+
+/// @brief Builds the runtime value of a compile-time node.
+template <CValue Node>
+inline Value from_node() {
+  return detail::node_traits<Node>::make();
+}
+
+/// @brief Whether v has the same contents as the compile-time node. Object
+/// members are compared regardless of their order.
+template <CValue Node>
+inline bool equals(const Value &v) noexcept {
+  return detail::node_traits<Node>::equals(v);
+}
+
+} // namespace gkxx::ctjson::dom
+
+#endif // GKXX_CTJSON_DOM_HPP
@@ -24,7 +24,7 @@ struct fixed_string {
   constexpr std::string to_string() const noexcept {
     return std::string(to_string_view());
   }
-  consteval auto operator[](std::size_t i) const noexcept {
+  constexpr auto operator[](std::size_t i) const noexcept {
     return data[i];
   }
   template <std::size_t Begin, std::size_t End>
@@ -34,7 +34,7 @@ struct fixed_string {
     copy[End - Begin] = '\0';
     return copy;
   }
-  static consteval auto size() noexcept {
+  static constexpr auto size() noexcept {
     return N;
   }
   char data[N + 1]{};
@@ -43,6 +43,19 @@ struct fixed_string {
 template <std::size_t N>
 fixed_string(const char (&)[N]) -> fixed_string<N - 1>;
 
+/// @brief A fixed_string lifted into a type, so that it can be passed to a
+/// function as an argument and still be used as a constant expression.
+template <fixed_string S>
+struct fixed_string_constant {
+  static constexpr auto value = S;
+  constexpr operator decltype(S)() const noexcept {
+    return S;
+  }
+  constexpr std::string_view to_string_view() const noexcept {
+    return S.to_string_view();
+  }
+};
+
 template <std::size_t N, std::size_t M>
   requires(N != M)
 inline consteval bool operator==(const fixed_string<N> &,
@@ -0,0 +1,164 @@
+#ifndef GKXX_CTJSON_FOLD_HPP
+#define GKXX_CTJSON_FOLD_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "ctjson.hpp"
+
+namespace gkxx::ctjson {
+
+/// @brief The events fold<> feeds to its reducer, in document order. Members
+/// produce key{...} followed by the events of their value.
+namespace events {
+
+  struct begin_object {};
+  struct end_object {};
+  struct begin_array {};
+  struct end_array {};
+  struct key {
+    std::string name;
+  };
+  struct string {
+    std::string value;
+  };
+  struct integer {
+    int value;
+  };
+  struct boolean {
+    bool value;
+  };
+  struct null {};
+
+} // namespace events
+
+namespace detail {
+
+  /// @brief The visitor of walk_syntax that calls reducer(state, event) for
+  /// every event instead of building nodes. The tokens come from the same
+  /// token_table as parse<Src>, so fold accepts exactly what parse<Src>
+  /// accepts, with the same messages, and all the work happens within a few
+  /// constant evaluations, with no template instantiated per token or node.
+  /// Events the reducer cannot take leave the state unchanged.
+  template <CSource auto Src, typename Reducer, typename State>
+  struct fold_visitor {
+    static constexpr const auto &tokens = token_table<Src>::tokens;
+
+    const Reducer &reducer;
+    State state;
+
+    template <typename Event>
+    constexpr void emit(const Event &event) {
+      if constexpr (std::is_invocable_r_v<State, const Reducer &, State &&,
+                                          const Event &>)
+        state = reducer(std::move(state), event);
+    }
+
+    constexpr std::string contents(std::size_t i) const {
+      std::string out;
+      lex::append_contents(Src, tokens[i].begin, tokens[i].end, out);
+      return out;
+    }
+
+    constexpr void scalar(std::size_t i) {
+      switch (tokens[i].kind) {
+      case lex::token_kind::String:
+        emit(events::string{contents(i)});
+        break;
+      case lex::token_kind::Integer:
+        emit(events::integer{tokens[i].value});
+        break;
+      case lex::token_kind::Null:
+        emit(events::null{});
+        break;
+      default:
+        emit(events::boolean{tokens[i].kind == lex::token_kind::True});
+        break;
+      }
+    }
+    constexpr void open(std::size_t i) {
+      if (Src[tokens[i].begin] == '{')
+        emit(events::begin_object{});
+      else
+        emit(events::begin_array{});
+    }
+    constexpr void key(std::size_t i) { emit(events::key{contents(i)}); }
+    constexpr void close(std::size_t i, std::size_t, std::size_t) {
+      if (Src[tokens[i].begin] == '{')
+        emit(events::end_object{});
+      else
+        emit(events::end_array{});
+    }
+  };
+
+  template <typename State>
+  struct fold_outcome {
+    State state;
+    bool ok;
+    std::string_view error_message;
+    std::size_t error_position;
+  };
+
+  template <CSource auto Src, typename Reducer, auto Init>
+  consteval auto run_fold() {
+    using State = std::remove_cv_t<decltype(Init)>;
+    using table = token_table<Src>;
+    if constexpr (!table::error.empty())
+      return fold_outcome<State>{Init, false, table::error,
+                                 table::scanned.error_position};
+    else {
+      constexpr Reducer reducer{};
+      fold_visitor<Src, Reducer, State> visitor{reducer, Init};
+      auto checked = walk_syntax(Src, table::tokens, visitor);
+      // Syntax errors are at a token index; fold reports them in Src.
+      auto position = checked.error_position < table::size
+                          ? table::tokens[checked.error_position].begin
+                          : Src.size();
+      return fold_outcome<State>{visitor.state, checked.error.empty(),
+                                 checked.error, position};
+    }
+  }
+
+} // namespace detail
+
+/// @brief Folds the events of the document Src into Init with Reducer, without
+/// building any node types:
+///
+///   struct count_integers {
+///     constexpr int operator()(int n, events::integer) const { return n + 1; }
+///   };
+///   static_assert(fold<"[1, \"a\", 2]", count_integers, 0>::value == 2);
+///
+/// Reducer is a default-constructible literal type whose call operator takes
+/// the state and an event and returns the new state; the state must be usable
+/// as a constant (no allocation left behind). If Src is not valid JSON, ok is
+/// false, value is the state reached so far, and error_message is what
+/// parse<Src> would report. error_position is always an offset into Src, also
+/// for the syntax errors that parse<Src> reports at a token index.
+template <fixed_string Src, typename Reducer, auto Init>
+struct fold {
+  static constexpr auto outcome = detail::run_fold<Src, Reducer, Init>();
+  static constexpr bool ok = outcome.ok;
+  static constexpr auto value = outcome.state;
+  static constexpr std::string_view error_message = outcome.error_message;
+  static constexpr std::size_t error_position = outcome.error_position;
+};
+
+/// @brief fold over the bytes of a constexpr array, as parse_bytes does.
+template <const auto &Bytes, typename Reducer, auto Init>
+struct fold_bytes {
+  static constexpr auto outcome =
+      detail::run_fold<byte_source{&Bytes}, Reducer, Init>();
+  static constexpr bool ok = outcome.ok;
+  static constexpr auto value = outcome.state;
+  static constexpr std::string_view error_message = outcome.error_message;
+  static constexpr std::size_t error_position = outcome.error_position;
+};
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_FOLD_HPP
@@ -0,0 +1,283 @@
+#ifndef GKXX_CTJSON_INCREMENTAL_HPP
+#define GKXX_CTJSON_INCREMENTAL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "dom.hpp"
+
+// A runtime document that is updated by re-parsing only what an edit touched.
+//
+// Along with the DOM, the document keeps the byte range of every value, each
+// relative to its parent, so that moving a subtree only changes the numbers of
+// its root. A new text is compared with the old one to find the common prefix
+// and suffix. The edit lies between them, inside the smallest container whose
+// brackets are both unchanged. Within that container, the elements (or
+// members) between the last delimiter before the edit and the first delimiter
+// after it are parsed again from the new text and spliced in place of the old
+// ones; the ranges of the following siblings and of the ancestors are shifted.
+//
+// Finding the prefix and suffix and keeping a copy of the text still cost time
+// linear in its size, but only memory comparisons and copies; parsing is
+// proportional to the elements touched. If the edit changes the structure
+// around it (e.g. removes a bracket), or the re-parsed part is not valid on
+// its own, the whole text is parsed again, which also reports errors exactly
+// as dom::parse does.
+
+namespace gkxx::ctjson::dom {
+
+class incremental_document {
+ public:
+  /// @param resource Used for the whole lifetime of the document, including
+  /// the values replaced by updates, so it should be able to reuse memory.
+  /// @throws parse_error
+  explicit incremental_document(
+      std::string text,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : m_resource{resource} {
+    parse_all(std::move(text));
+  }
+
+  const Value &root() const noexcept {
+    return m_root;
+  }
+  std::string_view text() const noexcept {
+    return m_text;
+  }
+
+  /// @brief Replaces the text of the document.
+  /// @return The number of bytes that were parsed again.
+  /// @throws parse_error if the new text is invalid, leaving the document
+  /// unchanged.
+  std::size_t update(std::string text) {
+    std::string_view old = m_text;
+    auto limit = std::min(old.size(), text.size());
+    auto prefix = static_cast<std::size_t>(
+        std::mismatch(old.begin(), old.begin() + limit, text.begin()).first -
+        old.begin());
+    if (prefix == limit && old.size() == text.size())
+      return 0;
+    std::size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           old[old.size() - 1 - suffix] == text[text.size() - 1 - suffix])
+      ++suffix;
+    try {
+      if (auto parsed = update_range(text, prefix, old.size() - suffix)) {
+        m_text = std::move(text);
+        return *parsed;
+      }
+    } catch (const parse_error &) {
+    }
+    return parse_all(std::move(text));
+  }
+
+ private:
+  using span_type = detail::value_span;
+
+  std::size_t parse_all(std::string text) {
+    span_type spans;
+    m_root = detail::Parser{text, m_resource, &spans}.parse_document();
+    m_span = std::move(spans.children.front());
+    m_text = std::move(text);
+    return m_text.size();
+  }
+
+  static bool is_container(const Value &value) noexcept {
+    return value.is_array() || value.is_object();
+  }
+
+  static Value &child_value(Value &value, std::size_t i) {
+    return value.is_array() ? value.as_array()[i] : value.as_object().value(i);
+  }
+
+  // The key table of the container, or of an object next to the children
+  // [left, right) of an array, for the new children to share.
+  static const key_table *nearby_keys(const Value &container, std::size_t left,
+                                      std::size_t right) noexcept {
+    if (container.is_object())
+      return container.as_object().keys();
+    const auto &elements = container.as_array();
+    for (auto i : {left - 1, right})
+      if (i < elements.size() && elements[i].is_object() &&
+          elements[i].as_object().keys())
+        return elements[i].as_object().keys();
+    return nullptr;
+  }
+
+  static void shift(span_type &span, std::ptrdiff_t delta) noexcept {
+    span.begin += static_cast<std::size_t>(delta);
+    span.end += static_cast<std::size_t>(delta);
+  }
+
+  // The edit replaced old[first, last) with text[first, last + delta).
+  // Returns the number of bytes parsed, or nullopt if the edit cannot be
+  // confined to a container.
+  std::optional<std::size_t> update_range(std::string_view text,
+                                          std::size_t first,
+                                          std::size_t last) {
+    std::string_view old = m_text;
+    auto delta = static_cast<std::ptrdiff_t>(text.size()) -
+                 static_cast<std::ptrdiff_t>(old.size());
+
+    // Descend to the smallest container whose brackets are outside the edit.
+    auto *span = &m_span;
+    auto *value = &m_root;
+    auto begin = m_span.begin;
+    if (!is_container(*value) || begin >= first || m_span.end - 1 < last)
+      return std::nullopt;
+    std::vector<std::pair<span_type *, std::size_t>> path;
+    while (true) {
+      auto &children = span->children;
+      auto next = std::partition_point(
+          children.begin(), children.end(),
+          [&](const span_type &child) { return begin + child.begin < first; });
+      if (next == children.begin())
+        break;
+      auto i = static_cast<std::size_t>(next - children.begin()) - 1;
+      auto &child = children[i];
+      if (!is_container(child_value(*value, i)) || begin + child.end - 1 < last)
+        break;
+      path.emplace_back(span, i);
+      value = &child_value(*value, i);
+      span = &child;
+      begin += child.begin;
+    }
+
+    // Delimiter k is the opening bracket for k == 0, and the ',' or closing
+    // bracket after child k - 1 otherwise. An empty container has its closing
+    // bracket as delimiter 1.
+    auto &children = span->children;
+    auto last_delimiter = std::max<std::size_t>(children.size(), 1);
+    auto delimiter = [&](std::size_t k) {
+      if (k == 0)
+        return begin;
+      if (children.empty())
+        return begin + (span->end - span->begin) - 1;
+      auto pos = begin + children[k - 1].end;
+      while (is_whitespace(old[pos]))
+        ++pos;
+      return pos;
+    };
+    auto first_delimiter_from = [&](std::size_t pos) {
+      std::size_t lo = 0, hi = last_delimiter;
+      while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        if (delimiter(mid) < pos)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      return lo;
+    };
+    auto left = first_delimiter_from(first) - 1;
+    auto right = first_delimiter_from(last);
+    auto from = delimiter(left);
+    auto to = static_cast<std::size_t>(
+        static_cast<std::ptrdiff_t>(delimiter(right)) + delta);
+    // Children [left, right) are replaced.
+    right = std::min(right, children.size());
+
+    // Parse what lies between the two delimiters in the new text.
+    span_type spans;
+    detail::Parser parser{text, m_resource, &spans, begin};
+    if (auto table = nearby_keys(*value, left, right))
+      parser.use_keys(*table);
+    std::vector<Value> values;
+    std::vector<std::string> keys;
+    auto pos = from + 1;
+    auto skip_whitespace = [&] {
+      while (pos < to && is_whitespace(text[pos]))
+        ++pos;
+    };
+    skip_whitespace();
+    if (pos == to) {
+      if (left != 0 || right != children.size())
+        return std::nullopt;
+    } else
+      while (true) {
+        if (value->is_object()) {
+          if (text[pos] != '"')
+            return std::nullopt;
+          auto &key = keys.emplace_back();
+          detail::lex_string(text, pos, key);
+          skip_whitespace();
+          if (pos >= to || text[pos] != ':')
+            return std::nullopt;
+          ++pos;
+          skip_whitespace();
+        }
+        values.push_back(parser.parse_value_at(pos, path.size() + 1));
+        skip_whitespace();
+        if (pos == to)
+          break;
+        if (pos > to || text[pos] != ',')
+          return std::nullopt;
+        ++pos;
+        skip_whitespace();
+      }
+
+    if (value->is_object()) {
+      const auto &members = value->as_object();
+      for (std::size_t i = 0; i != keys.size(); ++i) {
+        for (std::size_t j = 0; j != i; ++j)
+          if (keys[j] == keys[i])
+            return std::nullopt;
+        for (std::size_t j = 0; j != members.size(); ++j)
+          if ((j < left || j >= right) && members.key(j) == keys[i])
+            return std::nullopt;
+      }
+    }
+
+    // Splice the new children in.
+    for (auto i = right; i != children.size(); ++i)
+      shift(children[i], delta);
+    children.erase(children.begin() + static_cast<std::ptrdiff_t>(left),
+                   children.begin() + static_cast<std::ptrdiff_t>(right));
+    children.insert(children.begin() + static_cast<std::ptrdiff_t>(left),
+                    std::make_move_iterator(spans.children.begin()),
+                    std::make_move_iterator(spans.children.end()));
+    if (value->is_array()) {
+      auto &elements = value->as_array();
+      auto at = elements.erase(
+          elements.begin() + static_cast<std::ptrdiff_t>(left),
+          elements.begin() + static_cast<std::ptrdiff_t>(right));
+      elements.insert(at, std::make_move_iterator(values.begin()),
+                      std::make_move_iterator(values.end()));
+    } else {
+      // The keys have changed, and so has the shape.
+      auto &members = value->as_object();
+      ObjectBuilder builder(members, m_resource);
+      for (std::size_t j = 0; j != left; ++j)
+        builder.add(members.key(j), std::move(members.value(j)));
+      for (std::size_t i = 0; i != values.size(); ++i)
+        builder.add(keys[i], std::move(values[i]));
+      for (auto j = right; j != members.size(); ++j)
+        builder.add(members.key(j), std::move(members.value(j)));
+      members = builder.finish();
+    }
+    span->end += static_cast<std::size_t>(delta);
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      auto &[ancestor, i] = *it;
+      for (auto j = i + 1; j != ancestor->children.size(); ++j)
+        shift(ancestor->children[j], delta);
+      ancestor->end += static_cast<std::size_t>(delta);
+    }
+    return to - from;
+  }
+
+  std::pmr::memory_resource *m_resource;
+  std::string m_text;
+  Value m_root;
+  span_type m_span; // of the root, relative to the beginning of the text
+};
+
+} // namespace gkxx::ctjson::dom
+
+#endif // GKXX_CTJSON_INCREMENTAL_HPP
@@ -0,0 +1,239 @@
+#ifndef GKXX_CTJSON_INPUT_HPP
+#define GKXX_CTJSON_INPUT_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GKXX_CTJSON_HAS_MMAP 1
+#else
+#include <fstream>
+#define GKXX_CTJSON_HAS_MMAP 0
+#endif
+
+#include "dom.hpp"
+
+// Input for the runtime parsers, followed by at least `padding` readable zero
+// bytes, so that a scanner loading a whole vector register at a time never
+// needs a bounds check near the end.
+//
+// Files are memory-mapped where possible and read directly from the page
+// cache. If the padding fits in the last page of the file, it is the zero
+// tail the kernel maps there; otherwise anonymous zero pages are reserved
+// first and the file is mapped over their beginning. Anything that cannot be
+// mapped (empty files, pipes, other platforms), and any file passed to
+// read_file, is read into an aligned buffer instead.
+
+namespace gkxx::ctjson {
+
+class input_source {
+ public:
+  static constexpr std::size_t padding = 64;
+  static constexpr std::size_t alignment = 64;
+
+  input_source() noexcept = default;
+
+  input_source(input_source &&other) noexcept
+      : m_data{std::exchange(other.m_data, nullptr)},
+        m_size{std::exchange(other.m_size, 0)},
+        m_mapped{std::exchange(other.m_mapped, 0)} {}
+
+  input_source &operator=(input_source other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_mapped, other.m_mapped);
+    return *this;
+  }
+
+  ~input_source() {
+    release();
+  }
+
+  /// @brief Maps the file, or reads it if it cannot be mapped.
+  /// @throws std::system_error if the file cannot be opened or read.
+  static input_source from_file(const std::filesystem::path &path) {
+    return load(path, true);
+  }
+
+  /// @brief Reads the file into an owned buffer without mapping it. Unlike a
+  /// mapping, the buffer stays readable if the file is truncated meanwhile.
+  /// @throws std::system_error if the file cannot be opened or read.
+  static input_source read_file(const std::filesystem::path &path) {
+    return load(path, false);
+  }
+
+  /// @brief Copies text into an aligned, padded buffer.
+  static input_source from_string(std::string_view text) {
+    auto result = allocate(text.size());
+    if (!text.empty())
+      std::memcpy(result.m_data, text.data(), text.size());
+    return result;
+  }
+
+  const char *data() const noexcept {
+    return m_data ? m_data : empty_input;
+  }
+  std::size_t size() const noexcept {
+    return m_size;
+  }
+  std::string_view view() const noexcept {
+    return {data(), m_size};
+  }
+  /// @brief Whether the bytes come straight from a memory mapping.
+  bool is_mapped() const noexcept {
+    return m_mapped != 0;
+  }
+
+ private:
+  static constexpr char empty_input[padding] = {};
+
+  static input_source load(const std::filesystem::path &path,
+                           [[maybe_unused]] bool may_map) {
+#if GKXX_CTJSON_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw_errno("cannot open " + path.string());
+    struct fd_guard {
+      int fd;
+      ~fd_guard() {
+        ::close(fd);
+      }
+    } guard{fd};
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+      throw_errno("cannot stat " + path.string());
+    if (may_map && S_ISREG(info.st_mode) && info.st_size > 0)
+      if (auto mapped = map(fd, static_cast<std::size_t>(info.st_size));
+          mapped.data())
+        return mapped;
+    return read_all(fd, path);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+      throw std::system_error(std::make_error_code(std::errc::io_error),
+                              "cannot open " + path.string());
+    auto result = allocate(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(result.m_data, static_cast<std::streamsize>(result.m_size)))
+      throw std::system_error(std::make_error_code(std::errc::io_error),
+                              "cannot read " + path.string());
+    return result;
+#endif
+  }
+
+  [[noreturn]] static void throw_errno(const std::string &what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  // A zeroed buffer of size + padding bytes.
+  static input_source allocate(std::size_t size) {
+    input_source result;
+    result.m_data = static_cast<char *>(
+        ::operator new(size + padding, std::align_val_t{alignment}));
+    result.m_size = size;
+    std::memset(result.m_data + size, 0, padding);
+    return result;
+  }
+
+  void release() noexcept {
+    if (!m_data)
+      return;
+#if GKXX_CTJSON_HAS_MMAP
+    if (m_mapped) {
+      ::munmap(m_data, m_mapped);
+      return;
+    }
+#endif
+    ::operator delete(m_data, std::align_val_t{alignment});
+  }
+
+#if GKXX_CTJSON_HAS_MMAP
+  // An empty input_source if the file cannot be mapped.
+  static input_source map(int fd, std::size_t size) noexcept {
+    auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto file_pages = (size + page - 1) / page * page;
+    auto total = (size + padding + page - 1) / page * page;
+    void *base = nullptr;
+    if (total == file_pages)
+      base = ::mmap(nullptr, total, PROT_READ, MAP_PRIVATE, fd, 0);
+    else {
+      base = ::mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1, 0);
+      if (base != MAP_FAILED &&
+          ::mmap(base, file_pages, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd,
+                 0) == MAP_FAILED) {
+        ::munmap(base, total);
+        base = MAP_FAILED;
+      }
+    }
+    if (base == MAP_FAILED)
+      return {};
+    // Only hints: failures are ignored.
+    ::madvise(base, file_pages, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    ::madvise(base, file_pages, MADV_HUGEPAGE);
+#endif
+    input_source result;
+    result.m_data = static_cast<char *>(base);
+    result.m_size = size;
+    result.m_mapped = total;
+    return result;
+  }
+
+  static input_source read_all(int fd, const std::filesystem::path &path) {
+    std::size_t capacity = 1 << 16;
+    auto result = allocate(capacity);
+    std::size_t size = 0;
+    while (true) {
+      if (size == capacity) {
+        auto larger = allocate(capacity *= 2);
+        std::memcpy(larger.m_data, result.m_data, size);
+        result = std::move(larger);
+      }
+      auto n = ::read(fd, result.m_data + size, capacity - size);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        throw_errno("cannot read " + path.string());
+      }
+      if (n == 0)
+        break;
+      size += static_cast<std::size_t>(n);
+    }
+    std::memset(result.m_data + size, 0, padding);
+    result.m_size = size;
+    return result;
+  }
+#endif
+
+  char *m_data = nullptr;
+  std::size_t m_size = 0;
+  std::size_t m_mapped = 0; // length of the mapping, or 0 if allocated
+};
+
+namespace dom {
+
+  /// @brief Parses the document held by `input`.
+  inline Value
+  parse(const input_source &input,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    return parse(input.view(), resource);
+  }
+
+} // namespace dom
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_INPUT_HPP
@@ -0,0 +1,208 @@
+#ifndef GKXX_CTJSON_INSTRUMENT_HPP
+#define GKXX_CTJSON_INSTRUMENT_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+// Counters and stage timers for the runtime parser, reported to a sink after
+// every successfully parsed document.
+//
+// Everything is off unless GKXX_CTJSON_INSTRUMENT is defined to 1 before the
+// first include. The parser's hooks are written as
+// GKXX_CTJSON_INSTRUMENTED(...), which expands to nothing when it is off, so
+// an uninstrumented parser has neither the extra members nor the extra work.
+// The types below are always declared, so that code setting up a sink need not
+// be guarded itself.
+//
+// Every TU of a program must see the same value of GKXX_CTJSON_INSTRUMENT.
+// The parser classes (dom::detail::Parser among them) have extra members when
+// it is on, so two TUs that disagree define them differently, which is an ODR
+// violation rather than a per-TU choice. test_instrument.cpp is built as a
+// program of its own for this reason.
+
+#ifndef GKXX_CTJSON_INSTRUMENT
+#define GKXX_CTJSON_INSTRUMENT 0
+#endif
+
+#if GKXX_CTJSON_INSTRUMENT
+#define GKXX_CTJSON_INSTRUMENTED(...) __VA_ARGS__
+#else
+#define GKXX_CTJSON_INSTRUMENTED(...)
+#endif
+
+namespace gkxx::ctjson::dom::instrument {
+
+using clock = std::chrono::steady_clock;
+
+/// @brief What one parse did. Parallel parses report once for the whole
+/// document.
+struct parse_stats {
+  std::size_t bytes = 0;
+  /// @brief Number of values of each kind, indexed by dom::Kind.
+  std::array<std::size_t, 7> nodes{};
+  /// @brief Deepest nesting of objects and arrays; 0 for a scalar document.
+  std::size_t max_depth = 0;
+  /// @brief Bytes of strings and keys after unescaping.
+  std::size_t string_bytes = 0;
+  /// @brief Bytes allocated during the parse, if the memory resource is a
+  /// counting_resource, and 0 otherwise.
+  std::size_t arena_bytes = 0;
+  /// @brief Time spent finding the structure of the input before building
+  /// values. Only the parallel parser has such a stage.
+  clock::duration scan_time{};
+  clock::duration build_time{};
+
+  std::size_t node_count() const noexcept {
+    std::size_t count = 0;
+    for (auto n : nodes)
+      count += n;
+    return count;
+  }
+
+  double bytes_per_second() const noexcept {
+    auto seconds = std::chrono::duration<double>(scan_time + build_time);
+    return seconds.count() > 0 ? static_cast<double>(bytes) / seconds.count()
+                               : 0.0;
+  }
+
+  /// @brief Sums everything but max_depth, which is the larger of the two.
+  parse_stats &operator+=(const parse_stats &other) noexcept {
+    bytes += other.bytes;
+    for (std::size_t i = 0; i != nodes.size(); ++i)
+      nodes[i] += other.nodes[i];
+    max_depth = std::max(max_depth, other.max_depth);
+    string_bytes += other.string_bytes;
+    arena_bytes += other.arena_bytes;
+    scan_time += other.scan_time;
+    build_time += other.build_time;
+    return *this;
+  }
+};
+
+/// @brief Receives the stats of every parse. record() may be called from
+/// several threads at once.
+class sink {
+ public:
+  virtual ~sink() = default;
+  virtual void record(const parse_stats &stats) noexcept = 0;
+};
+
+/// @brief A sink keeping the totals over all parses.
+class aggregate : public sink {
+ public:
+  struct totals {
+    std::size_t parses = 0;
+    parse_stats stats;
+  };
+
+  void record(const parse_stats &stats) noexcept override {
+    std::lock_guard lock{m_mutex};
+    ++m_totals.parses;
+    m_totals.stats += stats;
+  }
+
+  totals snapshot() const {
+    std::lock_guard lock{m_mutex};
+    return m_totals;
+  }
+
+  void reset() noexcept {
+    std::lock_guard lock{m_mutex};
+    m_totals = {};
+  }
+
+ private:
+  mutable std::mutex m_mutex;
+  totals m_totals;
+};
+
+namespace detail {
+
+  inline std::atomic<sink *> current_sink{nullptr};
+
+} // namespace detail
+
+/// @brief Sends the stats of every parse from now on to `s`, or nowhere if it
+/// is null. The sink must outlive the parses using it.
+/// @return The previous sink.
+inline sink *set_sink(sink *s) noexcept {
+  return detail::current_sink.exchange(s, std::memory_order_acq_rel);
+}
+
+inline void report(const parse_stats &stats) noexcept {
+  if (auto s = detail::current_sink.load(std::memory_order_acquire))
+    s->record(stats);
+}
+
+/// @brief Forwards to another resource, counting the bytes allocated through
+/// it. Thread-safe if the upstream resource is.
+class counting_resource : public std::pmr::memory_resource {
+ public:
+  explicit counting_resource(std::pmr::memory_resource *upstream =
+                                 std::pmr::get_default_resource()) noexcept
+      : m_upstream{upstream} {}
+
+  std::size_t allocated() const noexcept {
+    return m_allocated.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    auto p = m_upstream->allocate(bytes, alignment);
+    m_allocated.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+  }
+
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override {
+    m_upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource *m_upstream;
+  std::atomic<std::size_t> m_allocated{0};
+};
+
+/// @brief Measures one document from construction to finish(): its size, its
+/// time and what it took from the memory resource.
+class document_scope {
+ public:
+  document_scope(std::size_t bytes,
+                 std::pmr::memory_resource *resource) noexcept
+      : m_bytes{bytes},
+        m_counter{dynamic_cast<const counting_resource *>(resource)},
+        m_allocated{m_counter ? m_counter->allocated() : 0} {}
+
+  clock::time_point start() const noexcept {
+    return m_start;
+  }
+
+  /// @brief Completes `stats`, taking everything not in scan_time as
+  /// build_time, and reports it.
+  void finish(parse_stats &stats) const noexcept {
+    stats.bytes = m_bytes;
+    if (m_counter)
+      stats.arena_bytes = m_counter->allocated() - m_allocated;
+    stats.build_time = clock::now() - m_start - stats.scan_time;
+    report(stats);
+  }
+
+ private:
+  std::size_t m_bytes;
+  const counting_resource *m_counter;
+  std::size_t m_allocated;
+  clock::time_point m_start = clock::now();
+};
+
+} // namespace gkxx::ctjson::dom::instrument
+
+#endif // GKXX_CTJSON_INSTRUMENT_HPP
@@ -0,0 +1,69 @@
+#ifndef GKXX_CTJSON_LEXER_HPP
+#define GKXX_CTJSON_LEXER_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "char_class.hpp"
+#include "dom.hpp"
+
+// A runtime lexer driven by the same character-class table and DFA as the
+// compile-time Tokenizer, one byte at a time. It is the portable fallback for
+// targets without the SIMD scans, and accepts exactly the tokens the Tokenizer
+// accepts.
+
+namespace gkxx::ctjson::dom {
+
+using lex::token_kind;
+
+/// @brief A token as written in the source: strings keep their quotes and
+/// escapes. For integers, `value` holds the value.
+struct token {
+  token_kind kind;
+  std::string_view text;
+  std::size_t position;
+  int value = 0;
+};
+
+/// @brief Splits a document into tokens. Only the tokens are checked, not the
+/// grammar; invalid tokens throw parse_error with the Tokenizer's messages.
+class scalar_lexer {
+ public:
+  explicit scalar_lexer(std::string_view src) noexcept : m_src{src} {}
+
+  /// @brief The next token, or std::nullopt at the end of the source.
+  std::optional<token> next() {
+    while (m_pos < m_src.size() && is_whitespace(m_src[m_pos]))
+      ++m_pos;
+    if (m_pos == m_src.size())
+      return std::nullopt;
+    auto lexeme = lex::scan(m_src, m_pos);
+    if (lexeme.kind == token_kind::Error)
+      throw parse_error(std::string(lexeme.error), lexeme.error_position);
+    token result{lexeme.kind,
+                 m_src.substr(lexeme.begin, lexeme.end - lexeme.begin),
+                 lexeme.begin};
+    if (lexeme.kind == token_kind::Integer) {
+      auto checked = lex::check_integer(m_src, lexeme.begin, lexeme.end);
+      if (!checked.error.empty())
+        throw parse_error(std::string(checked.error), checked.error_position);
+      result.value = checked.value;
+    }
+    m_pos = lexeme.end;
+    return result;
+  }
+
+  std::size_t pos() const noexcept {
+    return m_pos;
+  }
+
+ private:
+  std::string_view m_src;
+  std::size_t m_pos = 0;
+};
+
+} // namespace gkxx::ctjson::dom
+
+#endif // GKXX_CTJSON_LEXER_HPP
@@ -0,0 +1,131 @@
+#ifndef GKXX_CTJSON_MERGE_PATCH_HPP
+#define GKXX_CTJSON_MERGE_PATCH_HPP
+
+#include <type_traits>
+
+#include "ctjson.hpp"
+
+/*
+JSON Merge Patch (RFC 7396):
+  MergePatch(Target, Patch):
+    if Patch is an Object:
+      if Target is not an Object:
+        Target = {}
+      for each Name/Value pair in Patch:
+        if Value is Null:
+          remove Name from Target
+        else:
+          Target[Name] = MergePatch(Target[Name], Value)
+      return Target
+    else:
+      return Patch
+ */
+
+namespace gkxx::ctjson {
+
+namespace detail {
+
+  template <typename... Objects>
+  struct object_cat;
+
+  template <>
+  struct object_cat<> {
+    using result = Object<>;
+  };
+
+  template <CMember... Members>
+  struct object_cat<Object<Members...>> {
+    using result = Object<Members...>;
+  };
+
+  template <CMember... As, CMember... Bs, typename... Rest>
+  struct object_cat<Object<As...>, Object<Bs...>, Rest...> {
+    using result = typename object_cat<Object<As..., Bs...>, Rest...>::result;
+  };
+
+  template <typename Target, typename Patch>
+  struct merge_patch_impl {
+    using result = Patch;
+  };
+
+  // Target[Name] = MergePatch(Target[Name], Value), or removal if Value is Null
+  template <typename Target, CMember PatchMember>
+  struct apply_patch_member;
+
+  template <CMember... Members, fixed_string Key, CValue Value>
+  struct apply_patch_member<Object<Members...>, Member<Key, Value>> {
+    static constexpr auto exists =
+        Object<Members...>::template contains<Key>;
+
+    template <CMember M>
+    static consteval auto patch_one() noexcept {
+      if constexpr (!(M::key == Key))
+        return Object<M>{};
+      else if constexpr (std::is_same_v<Value, Null>)
+        return Object<>{};
+      else
+        return Object<Member<
+            Key,
+            typename merge_patch_impl<typename M::value, Value>::result>>{};
+    }
+
+    static consteval auto get_result() noexcept {
+      if constexpr (exists)
+        return typename object_cat<decltype(patch_one<Members>())...>::result{};
+      else if constexpr (std::is_same_v<Value, Null>)
+        return Object<Members...>{};
+      else
+        // A missing member is merged as if it were a non-object.
+        return Object<
+            Members...,
+            Member<Key, typename merge_patch_impl<Null, Value>::result>>{};
+    }
+    using result = decltype(get_result());
+  };
+
+  template <typename Target, typename... PatchMembers>
+  struct apply_patch_members {
+    using result = Target;
+  };
+
+  template <typename Target, typename First, typename... Rest>
+  struct apply_patch_members<Target, First, Rest...> {
+    using result = typename apply_patch_members<
+        typename apply_patch_member<Target, First>::result, Rest...>::result;
+  };
+
+  template <typename Target, CMember... PatchMembers>
+  struct merge_patch_impl<Target, Object<PatchMembers...>> {
+    using target_object =
+        std::conditional_t<meta::is_specialization_of_v<Target, Object>,
+                           Target, Object<>>;
+    using result =
+        typename apply_patch_members<target_object, PatchMembers...>::result;
+  };
+
+} // namespace detail
+
+/// @brief Applies Patch to Base as a JSON Merge Patch (RFC 7396). Members of
+/// Base keep their order; members added by Patch are appended in its order.
+template <CValue Base, CValue Patch>
+struct merge_patch {
+  using result = typename detail::merge_patch_impl<Base, Patch>::result;
+};
+
+/// @brief Applies each of Patches to Base in turn, e.g. a base config followed
+/// by more and more specific overrides.
+template <CValue Base, CValue... Patches>
+struct overlay {
+  using result = Base;
+};
+
+template <CValue Base, CValue First, CValue... Rest>
+struct overlay<Base, First, Rest...> {
+  using result =
+      typename overlay<typename merge_patch<Base, First>::result,
+                       Rest...>::result;
+};
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_MERGE_PATCH_HPP
@@ -0,0 +1,243 @@
+#ifndef GKXX_CTJSON_NDJSON_HPP
+#define GKXX_CTJSON_NDJSON_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <latch>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dom.hpp"
+#include "thread_pool.hpp"
+
+// Newline-delimited JSON: one document per line. The input is cut into chunks
+// that end at line breaks, and the chunks are parsed by a work-stealing pool.
+// Each chunk is parsed into a monotonic arena, so that building the records
+// costs a pointer bump per allocation and releasing them costs nothing per
+// record.
+
+namespace gkxx::ctjson::ndjson {
+
+enum class Order {
+  Preserved, // records are delivered on the calling thread, in input order
+  Unordered  // records are delivered on the workers as soon as parsed
+};
+
+struct Options {
+  std::size_t chunk_size = std::size_t{1} << 20;
+  Order order = Order::Preserved;
+  // Chunks parsed ahead of delivery per worker, in Preserved order.
+  std::size_t lookahead = 4;
+};
+
+/// @brief A malformed line, with the index of the record it would have been
+/// (blank lines do not count) and the position counted from the start of input.
+class record_error : public dom::parse_error {
+ public:
+  record_error(const dom::parse_error &error, std::size_t position,
+               std::size_t index)
+      : dom::parse_error(error.message() + " in record " +
+                             std::to_string(index),
+                         position),
+        m_index{index} {}
+  std::size_t index() const noexcept {
+    return m_index;
+  }
+
+ private:
+  std::size_t m_index;
+};
+
+namespace detail {
+
+  inline bool is_blank(std::string_view line) noexcept {
+    return line.find_first_not_of(" \t\r") == std::string_view::npos;
+  }
+
+  // The number of records on the lines that start before `end`, which starts a
+  // line. Only needed for errors, so it is counted again from the start.
+  inline std::size_t records_before(std::string_view input, std::size_t end) {
+    std::size_t count = 0;
+    std::size_t pos = 0;
+    while (pos < end) {
+      auto newline = std::min(input.find('\n', pos), end);
+      count += !is_blank(input.substr(pos, newline - pos));
+      pos = newline + 1;
+    }
+    return count;
+  }
+
+  struct line_chunk {
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  // Chunks of about `size` bytes, each ending right after a '\n' (or at the
+  // end of input).
+  inline std::vector<line_chunk> split_lines(std::string_view input,
+                                             std::size_t size) {
+    std::vector<line_chunk> chunks;
+    std::size_t begin = 0;
+    while (begin < input.size()) {
+      auto end = std::min(begin + std::max<std::size_t>(size, 1), input.size());
+      if (end < input.size()) {
+        end = input.find('\n', end - 1);
+        end = end == std::string_view::npos ? input.size() : end + 1;
+      }
+      chunks.push_back({begin, end});
+      begin = end;
+    }
+    return chunks;
+  }
+
+  // Parses every non-blank line of input[chunk] into `records`. The records
+  // of a chunk share one key table.
+  inline void parse_chunk(std::string_view input, line_chunk chunk,
+                          std::pmr::vector<dom::Value> &records,
+                          std::pmr::memory_resource *arena) {
+    dom::detail::Parser parser{{}, arena};
+    auto pos = chunk.begin;
+    while (pos < chunk.end) {
+      auto newline = input.find('\n', pos);
+      auto end = std::min(newline, chunk.end);
+      auto line = input.substr(pos, end - pos);
+      if (!is_blank(line)) {
+        try {
+          parser.reset(line);
+          records.push_back(parser.parse_document());
+        } catch (const dom::parse_error &e) {
+          throw record_error(e, pos + e.position(),
+                             records_before(input, pos));
+        }
+      }
+      pos = end + 1;
+    }
+  }
+
+  struct chunk_result {
+    std::pmr::monotonic_buffer_resource arena;
+    // Not braces: they would build a vector of one Value from the pointer.
+    std::pmr::vector<dom::Value> records =
+        std::pmr::vector<dom::Value>(&arena);
+    std::exception_ptr error;
+    bool ready = false;
+  };
+
+} // namespace detail
+
+/// @brief Parses every line of input and calls f(const dom::Value &) on each
+/// record. With Order::Unordered, f is called concurrently from the workers
+/// of the pool. The record is only valid during the call.
+/// @return The number of records.
+/// @throws record_error for the first malformed line (by position in Preserved
+/// order).
+template <typename F>
+std::size_t for_each_record(std::string_view input, work_stealing_pool &pool,
+                            F &&f, const Options &options = {}) {
+  auto chunks = detail::split_lines(input, options.chunk_size);
+
+  if (options.order == Order::Unordered) {
+    // One arena per worker, released after each chunk.
+    std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas(
+        pool.size());
+    for (auto &arena : arenas)
+      arena = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    std::mutex mutex;
+    std::exception_ptr error;
+    std::size_t error_chunk = chunks.size();
+    std::size_t count = 0;
+    std::latch finished{static_cast<std::ptrdiff_t>(chunks.size())};
+    for (std::size_t i = 0; i != chunks.size(); ++i)
+      pool.submit([&, i](std::size_t worker) {
+        auto &arena = *arenas[worker];
+        std::size_t n = 0;
+        try {
+          std::pmr::vector<dom::Value> records(&arena);
+          detail::parse_chunk(input, chunks[i], records, &arena);
+          for (const auto &record : records)
+            f(record);
+          n = records.size();
+        } catch (...) {
+          std::lock_guard lock{mutex};
+          if (i < error_chunk) {
+            error = std::current_exception();
+            error_chunk = i;
+          }
+        }
+        arena.release();
+        {
+          std::lock_guard lock{mutex};
+          count += n;
+        }
+        finished.count_down();
+      });
+    finished.wait();
+    if (error)
+      std::rethrow_exception(error);
+    return count;
+  }
+
+  std::vector<std::unique_ptr<detail::chunk_result>> results(chunks.size());
+  std::mutex mutex;
+  std::condition_variable ready;
+  auto window = std::max<std::size_t>(pool.size() * options.lookahead, 1);
+  std::size_t submitted = 0;
+  std::size_t finished = 0;
+  auto submit = [&] {
+    auto i = submitted++;
+    results[i] = std::make_unique<detail::chunk_result>();
+    pool.submit([&, i](std::size_t) {
+      auto &result = *results[i];
+      try {
+        detail::parse_chunk(input, chunks[i], result.records, &result.arena);
+      } catch (...) {
+        result.error = std::current_exception();
+      }
+      std::lock_guard lock{mutex};
+      result.ready = true;
+      ++finished;
+      ready.notify_all();
+    });
+  };
+
+  std::size_t count = 0;
+  std::exception_ptr error;
+  for (std::size_t i = 0; i != chunks.size() && !error; ++i) {
+    while (submitted < chunks.size() && submitted < i + window)
+      submit();
+    {
+      std::unique_lock lock{mutex};
+      ready.wait(lock, [&] { return results[i]->ready; });
+    }
+    if (results[i]->error)
+      error = results[i]->error;
+    else {
+      try {
+        for (const auto &record : results[i]->records)
+          f(record);
+        count += results[i]->records.size();
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    results[i].reset();
+  }
+  // The chunks parsed ahead still refer to this frame.
+  {
+    std::unique_lock lock{mutex};
+    ready.wait(lock, [&] { return finished == submitted; });
+  }
+  if (error)
+    std::rethrow_exception(error);
+  return count;
+}
+
+} // namespace gkxx::ctjson::ndjson
+
+#endif // GKXX_CTJSON_NDJSON_HPP
@@ -0,0 +1,519 @@
+#ifndef GKXX_CTJSON_ONDEMAND_HPP
+#define GKXX_CTJSON_ONDEMAND_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "dom.hpp"
+
+// Pull-based access to a document without building a DOM. A single forward
+// cursor walks the source: values are converted only when they are asked for,
+// and whatever the caller does not read is skipped by counting brackets. Only
+// the parts that are read are checked against the grammar.
+
+namespace gkxx::ctjson::ondemand {
+
+using dom::Kind;
+using dom::parse_error;
+
+namespace detail {
+
+  class Cursor {
+   public:
+    explicit Cursor(std::string_view src) noexcept : m_src{src} {}
+
+    std::string_view source() const noexcept {
+      return m_src;
+    }
+    std::size_t pos() const noexcept {
+      return m_pos;
+    }
+    std::size_t depth() const noexcept {
+      return m_depth;
+    }
+
+    [[noreturn]] void fail(const char *message) const {
+      throw parse_error(message, m_pos);
+    }
+
+    void skip_whitespace() noexcept {
+      while (m_pos < m_src.size() && is_whitespace(m_src[m_pos]))
+        ++m_pos;
+    }
+
+    char peek() const noexcept {
+      return m_pos < m_src.size() ? m_src[m_pos] : '\0';
+    }
+
+    void expect(char c, const char *message) {
+      skip_whitespace();
+      if (peek() != c)
+        fail(message);
+      ++m_pos;
+    }
+
+    bool consume(char c) noexcept {
+      skip_whitespace();
+      if (peek() != c)
+        return false;
+      ++m_pos;
+      return true;
+    }
+
+    void open(char c, const char *message) {
+      expect(c, message);
+      ++m_depth;
+    }
+
+    void close() noexcept {
+      --m_depth;
+    }
+
+    void move_to(std::size_t pos) noexcept {
+      m_pos = pos;
+    }
+
+    // Moves past the closing quote of the string starting at m_pos.
+    void skip_string() {
+      m_pos = dom::detail::lex_token(m_src, m_pos).end;
+    }
+
+    // Skips forward until the containers deeper than `depth` are closed.
+    void skip_to_depth(std::size_t depth) {
+      while (m_depth > depth) {
+        if (m_pos >= m_src.size())
+          fail("unexpected end of string");
+        switch (m_src[m_pos]) {
+        case '"':
+          skip_string();
+          continue;
+        case '{':
+        case '[':
+          ++m_depth;
+          break;
+        case '}':
+        case ']':
+          --m_depth;
+          break;
+        }
+        ++m_pos;
+      }
+    }
+
+    // Skips the value starting at m_pos.
+    void skip_value() {
+      skip_whitespace();
+      switch (peek()) {
+      case '"':
+        skip_string();
+        break;
+      case '{':
+      case '[': {
+        auto depth = m_depth;
+        ++m_depth;
+        ++m_pos;
+        skip_to_depth(depth);
+        break;
+      }
+      default:
+        if (m_pos == m_src.size())
+          fail("expects Value");
+        while (m_pos < m_src.size() && !is_whitespace(m_src[m_pos]) &&
+               m_src[m_pos] != ',' && m_src[m_pos] != '}' &&
+               m_src[m_pos] != ']')
+          ++m_pos;
+      }
+    }
+
+   private:
+    std::string_view m_src;
+    std::size_t m_pos = 0;
+    std::size_t m_depth = 0;
+  };
+
+  // Compares the raw contents of a string token with an unescaped string.
+  inline bool raw_string_equals(std::string_view raw,
+                                std::string_view str) noexcept {
+    lex::contents_reader reader{raw, 0, raw.size()};
+    for (auto c : str)
+      if (reader.done() || reader.get() != c)
+        return false;
+    return reader.done();
+  }
+
+} // namespace detail
+
+class Object;
+class Array;
+
+/// @brief A value that has not been read yet. Reading it moves the cursor
+/// forward, so each value can be read at most once, in document order.
+class Value {
+ public:
+  Value(detail::Cursor &cursor, std::size_t pos) noexcept
+      : m_cursor{&cursor}, m_pos{pos} {}
+
+  Kind kind() const {
+    auto src = m_cursor->source();
+    switch (m_pos < src.size() ? src[m_pos] : '\0') {
+    case '{':
+      return Kind::Object;
+    case '[':
+      return Kind::Array;
+    case '"':
+      return Kind::String;
+    case 't':
+      return Kind::True;
+    case 'f':
+      return Kind::False;
+    case 'n':
+      return Kind::Null;
+    default:
+      return Kind::Integer;
+    }
+  }
+
+  int get_integer() {
+    auto pos = start();
+    auto src = m_cursor->source();
+    if (pos == src.size() || (src[pos] != '-' && !is_digit(src[pos])))
+      m_cursor->fail("expects Integer");
+    auto value = dom::detail::lex_integer(src, pos);
+    m_cursor->move_to(pos);
+    return value;
+  }
+
+  std::string get_string() {
+    auto pos = start();
+    if (m_cursor->peek() != '"')
+      m_cursor->fail("expects String");
+    std::string value;
+    dom::detail::lex_string(m_cursor->source(), pos, value);
+    m_cursor->move_to(pos);
+    return value;
+  }
+
+  /// @brief The contents of a string between its quotes, escapes included.
+  /// Does not allocate.
+  std::string_view get_raw_string() {
+    auto pos = start();
+    if (m_cursor->peek() != '"')
+      m_cursor->fail("expects String");
+    m_cursor->skip_string();
+    return m_cursor->source().substr(pos + 1, m_cursor->pos() - pos - 2);
+  }
+
+  bool get_bool() {
+    start();
+    if (match("true"))
+      return true;
+    if (match("false"))
+      return false;
+    m_cursor->fail("expects 'true' or 'false'");
+  }
+
+  bool is_null() {
+    if (kind() != Kind::Null)
+      return false;
+    start();
+    if (!match("null"))
+      m_cursor->fail("expects 'null'");
+    return true;
+  }
+
+  Object get_object();
+  Array get_array();
+
+  /// @brief Reads the whole value into a DOM.
+  dom::Value materialize() {
+    auto pos = start();
+    m_cursor->skip_value();
+    return dom::parse(m_cursor->source().substr(pos, m_cursor->pos() - pos));
+  }
+
+  void skip() {
+    start();
+    m_cursor->skip_value();
+  }
+
+ private:
+  std::size_t start() const {
+    if (m_cursor->pos() != m_pos)
+      throw parse_error("value has already been read", m_pos);
+    return m_pos;
+  }
+
+  // Reads the keyword at m_pos, which must end before whitespace, punctuation
+  // or the end of the source.
+  bool match(std::string_view keyword) {
+    auto src = m_cursor->source();
+    if (src.substr(m_pos, keyword.size()) != keyword)
+      return false;
+    auto end = m_pos + keyword.size();
+    m_cursor->move_to(end);
+    if (end < src.size()) {
+      auto next = lex::classify(src[end]);
+      if (next != lex::char_class::Whitespace &&
+          next != lex::char_class::Punct)
+        m_cursor->fail("Unrecognized token");
+    }
+    return true;
+  }
+
+  detail::Cursor *m_cursor;
+  std::size_t m_pos;
+};
+
+class Field {
+ public:
+  Field(std::string_view raw_key, Value value) noexcept
+      : m_raw_key{raw_key}, m_value{value} {}
+
+  /// @brief The key between its quotes, escapes included.
+  std::string_view raw_key() const noexcept {
+    return m_raw_key;
+  }
+  bool key_equals(std::string_view key) const noexcept {
+    return detail::raw_string_equals(m_raw_key, key);
+  }
+  std::string key() const {
+    std::size_t pos = 0;
+    std::string quoted = '"' + std::string(m_raw_key) + '"';
+    std::string result;
+    dom::detail::lex_string(quoted, pos, result);
+    return result;
+  }
+  Value &value() noexcept {
+    return m_value;
+  }
+
+ private:
+  std::string_view m_raw_key;
+  Value m_value;
+};
+
+namespace detail {
+
+  // Shared by Object and Array: the state of iterating over the elements of
+  // one container at a given depth.
+  template <char Close>
+  class ContainerWalker {
+   public:
+    ContainerWalker(Cursor &cursor) noexcept
+        : m_cursor{&cursor}, m_depth{cursor.depth()} {}
+
+    bool done() const noexcept {
+      return m_done;
+    }
+
+    // Moves to the first element, or to the end of an empty container.
+    void start() {
+      if (m_cursor->consume(Close))
+        finish();
+    }
+
+    // Skips what is left of the current element and moves to the next one.
+    void advance() {
+      if (m_cursor->pos() == m_element_pos && m_cursor->depth() == m_depth)
+        m_cursor->skip_value();
+      else
+        m_cursor->skip_to_depth(m_depth);
+      if (m_cursor->consume(Close))
+        finish();
+      else if (!m_cursor->consume(','))
+        m_cursor->fail(Close == '}' ? "expects '}'" : "expects ']'");
+    }
+
+    void set_element_pos() noexcept {
+      m_cursor->skip_whitespace();
+      m_element_pos = m_cursor->pos();
+    }
+
+    std::size_t element_pos() const noexcept {
+      return m_element_pos;
+    }
+
+    Cursor &cursor() const noexcept {
+      return *m_cursor;
+    }
+
+   private:
+    void finish() noexcept {
+      m_cursor->close();
+      m_done = true;
+    }
+
+    Cursor *m_cursor;
+    std::size_t m_depth;
+    std::size_t m_element_pos = static_cast<std::size_t>(-1);
+    bool m_done = false;
+  };
+
+} // namespace detail
+
+class Object {
+ public:
+  explicit Object(detail::Cursor &cursor) : m_walker{cursor} {}
+
+  class iterator {
+   public:
+    explicit iterator(Object *object) noexcept : m_object{object} {}
+    Field operator*() const noexcept {
+      return m_object->m_current;
+    }
+    iterator &operator++() {
+      m_object->next();
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const noexcept {
+      return m_object->m_walker.done();
+    }
+
+   private:
+    Object *m_object;
+  };
+
+  iterator begin() {
+    ensure_started();
+    return iterator{this};
+  }
+  std::default_sentinel_t end() const noexcept {
+    return {};
+  }
+
+  /// @brief Scans forward from the current member for the given key, skipping
+  /// the members before it. Members already passed are not revisited.
+  std::optional<Value> find_field(std::string_view key) {
+    ensure_started();
+    while (!m_walker.done()) {
+      if (m_current.key_equals(key))
+        return m_current.value();
+      next();
+    }
+    return std::nullopt;
+  }
+
+  Value operator[](std::string_view key) {
+    if (auto value = find_field(key))
+      return *value;
+    throw parse_error("no such key: " + std::string(key),
+                      m_walker.cursor().pos());
+  }
+
+ private:
+  void ensure_started() {
+    if (!m_started) {
+      m_started = true;
+      m_walker.start();
+      if (!m_walker.done())
+        read_key();
+    }
+  }
+
+  void next() {
+    m_walker.advance();
+    if (!m_walker.done())
+      read_key();
+  }
+
+  void read_key() {
+    auto &cursor = m_walker.cursor();
+    cursor.skip_whitespace();
+    if (cursor.peek() != '"')
+      cursor.fail("expects String");
+    auto key_start = cursor.pos() + 1;
+    cursor.skip_string();
+    auto raw_key =
+        cursor.source().substr(key_start, cursor.pos() - key_start - 1);
+    cursor.expect(':', "expects ':'");
+    m_walker.set_element_pos();
+    m_current = Field{raw_key, Value{cursor, cursor.pos()}};
+  }
+
+  detail::ContainerWalker<'}'> m_walker;
+  Field m_current{{}, Value{m_walker.cursor(), 0}};
+  bool m_started = false;
+};
+
+class Array {
+ public:
+  explicit Array(detail::Cursor &cursor) : m_walker{cursor} {}
+
+  class iterator {
+   public:
+    explicit iterator(Array *array) noexcept : m_array{array} {}
+    Value operator*() const noexcept {
+      return m_array->current();
+    }
+    iterator &operator++() {
+      m_array->m_walker.advance();
+      if (!m_array->m_walker.done())
+        m_array->m_walker.set_element_pos();
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const noexcept {
+      return m_array->m_walker.done();
+    }
+
+   private:
+    Array *m_array;
+  };
+
+  iterator begin() {
+    if (!m_started) {
+      m_started = true;
+      m_walker.start();
+      if (!m_walker.done())
+        m_walker.set_element_pos();
+    }
+    return iterator{this};
+  }
+  std::default_sentinel_t end() const noexcept {
+    return {};
+  }
+
+ private:
+  // Starts at the element, not at the cursor, so that a Value taken again
+  // after part of the element has been read refuses to be read.
+  Value current() const noexcept {
+    return Value{m_walker.cursor(), m_walker.element_pos()};
+  }
+
+  detail::ContainerWalker<']'> m_walker;
+  bool m_started = false;
+};
+
+inline Object Value::get_object() {
+  start();
+  m_cursor->open('{', "expects '{'");
+  return Object{*m_cursor};
+}
+
+inline Array Value::get_array() {
+  start();
+  m_cursor->open('[', "expects '['");
+  return Array{*m_cursor};
+}
+
+/// @brief Owns the cursor over a source that must outlive it.
+class Document {
+ public:
+  explicit Document(std::string_view src) noexcept : m_cursor{src} {}
+  Document(const Document &) = delete;
+  Document &operator=(const Document &) = delete;
+
+  Value root() {
+    m_cursor.skip_whitespace();
+    return Value{m_cursor, m_cursor.pos()};
+  }
+
+ private:
+  detail::Cursor m_cursor;
+};
+
+} // namespace gkxx::ctjson::ondemand
+
+#endif // GKXX_CTJSON_ONDEMAND_HPP
@@ -0,0 +1,291 @@
+#ifndef GKXX_CTJSON_PARALLEL_PARSE_HPP
+#define GKXX_CTJSON_PARALLEL_PARSE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <latch>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "dom.hpp"
+#include "thread_pool.hpp"
+
+// Parallel parsing of one large document whose root is an array.
+//
+// The input is cut into fixed-size chunks. Whether a chunk starts inside a
+// string depends on all the quotes before it, so every chunk is first scanned
+// for its quote parity together with its change of nesting depth under both
+// guesses: starting outside a string and starting inside one. A prefix XOR over
+// the parities tells which guess is right for each chunk, and a prefix sum over
+// the matching depth changes gives the depth at its start. Then every chunk
+// parses the elements of the root array whose preceding ',' (or the '[') lies
+// in it, and the element lists are concatenated.
+//
+// The scan assumes well-formed input. Instead of reporting errors itself, the
+// parallel path checks that the elements meet exactly at the delimiters found
+// by the scan, and on any mismatch or parse error the document is parsed again
+// by dom::parse, which reports the error (or succeeds) exactly as it would on
+// its own.
+
+namespace gkxx::ctjson::dom {
+
+struct ParallelOptions {
+  std::size_t chunk_size = std::size_t{1} << 20;
+};
+
+/// @brief How parse_parallel read a document: `parallel` is false when it was
+/// parsed by dom::parse alone, because it is no larger than one chunk, its root
+/// is not an array, or the chunks did not fit together.
+struct ParallelStats {
+  bool parallel = false;
+  std::size_t chunks = 0;
+};
+
+namespace detail {
+
+  struct chunk_scan {
+    bool odd_quotes = false;
+    // Depth change if the chunk starts outside ([0]) or inside ([1]) a string.
+    long depth_delta[2] = {0, 0};
+  };
+
+  // Whether src[pos] is escaped, i.e. preceded by an odd number of '\\'.
+  inline bool is_escaped(std::string_view src, std::size_t pos) noexcept {
+    std::size_t backslashes = 0;
+    while (pos > backslashes && src[pos - backslashes - 1] == '\\')
+      ++backslashes;
+    return backslashes % 2 != 0;
+  }
+
+  inline chunk_scan scan_chunk(std::string_view src, std::size_t begin,
+                               std::size_t end) noexcept {
+    chunk_scan scan;
+    // in_string under the "outside" guess; the other guess is its negation.
+    bool in_string = false;
+    for (auto i = begin + is_escaped(src, begin); i < end; ++i) {
+      switch (src[i]) {
+      case '\\':
+        ++i;
+        break;
+      case '"':
+        in_string = !in_string;
+        break;
+      case '[':
+      case '{':
+        ++scan.depth_delta[in_string];
+        break;
+      case ']':
+      case '}':
+        --scan.depth_delta[in_string];
+        break;
+      }
+    }
+    scan.odd_quotes = in_string;
+    return scan;
+  }
+
+  // Position of the first ',' or ']' of the root array in [begin, end), given
+  // the state at begin.
+  inline std::optional<std::size_t>
+  find_delimiter(std::string_view src, std::size_t begin, std::size_t end,
+                 bool in_string, long depth) noexcept {
+    for (auto i = begin + is_escaped(src, begin); i < end; ++i) {
+      auto c = src[i];
+      if (c == '\\')
+        ++i;
+      else if (c == '"')
+        in_string = !in_string;
+      else if (in_string)
+        continue;
+      else if (c == '[' || c == '{')
+        ++depth;
+      else if (c == ']' || c == '}') {
+        if (--depth == 0)
+          return c == ']' ? std::optional{i} : std::nullopt;
+      } else if (c == ',' && depth == 1)
+        return i;
+    }
+    return std::nullopt;
+  }
+
+  struct chunk_elements {
+    std::optional<std::size_t> first; // delimiter the chunk starts from
+    std::size_t last = 0;              // delimiter after its last element
+    std::vector<Value> values;
+    GKXX_CTJSON_INSTRUMENTED(instrument::parse_stats stats;)
+  };
+
+  // Parses the elements following the delimiter `pos` while their delimiters
+  // lie before `end`.
+  inline void parse_elements(std::string_view src, std::size_t pos,
+                             std::size_t end, chunk_elements &out,
+                             std::pmr::memory_resource *resource) {
+    Parser parser{src, resource};
+    auto skip_whitespace = [&] {
+      while (pos < src.size() && is_whitespace(src[pos]))
+        ++pos;
+    };
+    if (src[pos] == '[') {
+      ++pos;
+      skip_whitespace();
+      if (pos < src.size() && src[pos] == ']') {
+        out.last = pos;
+        return;
+      }
+      --pos;
+    }
+    while (src[pos] != ']') {
+      ++pos;
+      skip_whitespace();
+      out.values.push_back(parser.parse_value_at(pos, 1));
+      skip_whitespace();
+      if (pos == src.size() || (src[pos] != ',' && src[pos] != ']'))
+        throw parse_error("expects ']'", pos);
+      if (pos >= end)
+        break;
+    }
+    out.last = pos;
+    GKXX_CTJSON_INSTRUMENTED(out.stats = parser.stats();)
+  }
+
+  // Runs f(i) for i in [0, n) on the pool and waits for all of them.
+  template <typename F>
+  void run_chunks(work_stealing_pool &pool, std::size_t n, F f) {
+    std::latch done{static_cast<std::ptrdiff_t>(n)};
+    for (std::size_t i = 0; i != n; ++i)
+      pool.submit([&, i](std::size_t) {
+        f(i);
+        done.count_down();
+      });
+    done.wait();
+  }
+
+  inline std::optional<Array>
+  try_parse_parallel(std::string_view src, work_stealing_pool &pool,
+                     std::pmr::memory_resource *resource,
+                     const ParallelOptions &options,
+                     ParallelStats *parallel_stats) {
+    GKXX_CTJSON_INSTRUMENTED(
+        instrument::document_scope document{src.size(), resource};
+        instrument::parse_stats stats;)
+    auto root = src.find_first_not_of(" \t\n\r");
+    if (root == std::string_view::npos || src[root] != '[')
+      return std::nullopt;
+    auto chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+    auto n = (src.size() - root + chunk_size - 1) / chunk_size;
+    auto begin_of = [&](std::size_t i) { return root + i * chunk_size; };
+    auto end_of = [&](std::size_t i) {
+      return std::min(begin_of(i + 1), src.size());
+    };
+    if (parallel_stats)
+      parallel_stats->chunks = n;
+
+    std::vector<chunk_scan> scans(n);
+    run_chunks(pool, n, [&](std::size_t i) {
+      scans[i] = scan_chunk(src, begin_of(i), end_of(i));
+    });
+
+    std::vector<bool> in_string(n);
+    std::vector<long> depth(n);
+    bool quote_state = false;
+    long current_depth = 0;
+    for (std::size_t i = 0; i != n; ++i) {
+      in_string[i] = quote_state;
+      depth[i] = current_depth;
+      if (current_depth < 0)
+        return std::nullopt;
+      current_depth += scans[i].depth_delta[quote_state];
+      quote_state = quote_state != scans[i].odd_quotes;
+    }
+    if (quote_state || current_depth != 0)
+      return std::nullopt;
+    GKXX_CTJSON_INSTRUMENTED(
+        stats.scan_time = instrument::clock::now() - document.start();)
+
+    std::vector<chunk_elements> parts(n);
+    std::mutex mutex;
+    std::exception_ptr error;
+    bool failed = false;
+    run_chunks(pool, n, [&](std::size_t i) {
+      try {
+        auto first = i == 0 ? std::optional{root}
+                            : find_delimiter(src, begin_of(i), end_of(i),
+                                             in_string[i], depth[i]);
+        parts[i].first = first;
+        if (first)
+          parse_elements(src, *first, end_of(i), parts[i], resource);
+      } catch (const parse_error &) {
+        std::lock_guard lock{mutex};
+        failed = true;
+      } catch (...) {
+        std::lock_guard lock{mutex};
+        error = std::current_exception();
+      }
+    });
+    if (error)
+      std::rethrow_exception(error);
+    if (failed)
+      return std::nullopt;
+
+    // Every chunk must resume exactly where the previous one stopped, and the
+    // last one must stop at the ']' closing the root.
+    std::optional<std::size_t> last;
+    std::size_t count = 0;
+    for (const auto &part : parts) {
+      if (!part.first)
+        continue;
+      if (last && *last != *part.first)
+        return std::nullopt;
+      last = part.last;
+      count += part.values.size();
+    }
+    if (src[*last] != ']' ||
+        src.find_first_not_of(" \t\n\r", *last + 1) != std::string_view::npos)
+      return std::nullopt;
+
+    Array values(resource);
+    values.reserve(count);
+    for (auto &part : parts)
+      for (auto &value : part.values)
+        values.push_back(std::move(value));
+#if GKXX_CTJSON_INSTRUMENT
+    // The chunks count from the elements down, within the root array.
+    for (const auto &part : parts)
+      stats += part.stats;
+    ++stats.nodes[static_cast<std::size_t>(Kind::Array)];
+    stats.max_depth = std::max<std::size_t>(stats.max_depth, 1);
+    document.finish(stats);
+#endif
+    if (parallel_stats)
+      parallel_stats->parallel = true;
+    return values;
+  }
+
+} // namespace detail
+
+/// @brief Parses src like dom::parse, splitting the work over the pool when
+/// the root is an array. Memory is allocated from `resource` by several
+/// threads at once, so it must be thread-safe. If `stats` is not null, it
+/// tells whether the chunks were used.
+inline Value
+parse_parallel(std::string_view src, work_stealing_pool &pool,
+               std::pmr::memory_resource *resource =
+                   std::pmr::get_default_resource(),
+               const ParallelOptions &options = {},
+               ParallelStats *stats = nullptr) {
+  if (stats)
+    *stats = {};
+  if (src.size() > options.chunk_size)
+    if (auto values =
+            detail::try_parse_parallel(src, pool, resource, options, stats))
+      return std::move(*values);
+  return parse(src, resource);
+}
+
+} // namespace gkxx::ctjson::dom
+
+#endif // GKXX_CTJSON_PARALLEL_PARSE_HPP
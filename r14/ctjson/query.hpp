@@ -0,0 +1,568 @@
+#ifndef GKXX_CTJSON_QUERY_HPP
+#define GKXX_CTJSON_QUERY_HPP
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ctjson.hpp"
+#include "dom.hpp"
+
+/*
+A subset of jq, compiled at compile time into a pipeline of stages that run
+over a dom::Value.
+
+Tokens:
+  '.', '[', ']', '(', ')', '|'
+  name: [A-Za-z_][A-Za-z0-9_]*
+  operator: == != < <= > >=
+  string, integer: as in JSON
+
+pipeline -> {term}
+          | {term} '|' {pipeline}
+term     -> '.' {suffixes}
+          | '.' name {suffixes}
+          | 'select' '(' {term} ')'
+          | 'select' '(' {term} operator {literal} ')'
+suffixes -> (empty)
+          | '.' name {suffixes}
+          | '[' ']' {suffixes}
+          | '[' Integer ']' {suffixes}
+literal  -> String | Integer | true | false | null
+
+Every stage passes each of its outputs straight to the next one, so a query
+is a single nest of loops with no intermediate arrays. As in jq, `.name` and
+`[n]` give null on null and on missing members; `[]` and steps that do not
+apply to a value (like `.name` on an array) give nothing instead of an error,
+as with jq's `?`. `select(f)` passes its input on once for every output of f
+that is neither null nor false, or that satisfies the comparison. `<`, `<=`,
+`>` and `>=` take an Integer or a String and are false for values of any
+other kind.
+ */
+
+namespace gkxx::ctjson::query {
+
+using Dot = PunctToken<'.'>;
+using Pipe = PunctToken<'|'>;
+using LParen = PunctToken<'('>;
+using RParen = PunctToken<')'>;
+
+inline constexpr bool is_name_start(char c) {
+  return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+inline constexpr bool is_name_char(char c) {
+  return is_name_start(c) || is_digit(c);
+}
+
+namespace detail {
+
+  /// @brief A token of a query: a name or an operator, which become a
+  /// KeywordToken of their text, or a token read as in JSON.
+  struct token_info {
+    bool word = false;
+    ctjson::detail::token_info json;
+  };
+
+  // Reads the tokens of src in one loop, as ctjson::detail::tokenize does,
+  // with the lexer DFA reading the strings and integers.
+  template <typename Source>
+  constexpr ctjson::detail::tokenize_result
+  tokenize(const Source &src, token_info *tokens = nullptr) {
+    ctjson::detail::tokenize_result result;
+    std::size_t pos = 0;
+    while (true) {
+      while (pos < src.size() && is_whitespace(src[pos]))
+        ++pos;
+      if (pos == src.size())
+        return result;
+      auto c = src[pos];
+      token_info token{false, {lex::token_kind::Punct, pos, pos + 1}};
+      if (is_name_start(c)) {
+        token.word = true;
+        while (token.json.end < src.size() && is_name_char(src[token.json.end]))
+          ++token.json.end;
+      } else if (c == '=' || c == '!' || c == '<' || c == '>') {
+        token.word = true;
+        if (pos + 1 < src.size() && src[pos + 1] == '=')
+          ++token.json.end;
+        else if (c == '=')
+          return {result.count, "expects '=='", pos};
+        else if (c == '!')
+          return {result.count, "expects '!='", pos};
+      } else if (c == '"' || c == '-' || is_digit(c)) {
+        auto lexeme = lex::scan(src, pos);
+        if (lexeme.kind == lex::token_kind::Error)
+          return {result.count, lexeme.error, lexeme.error_position};
+        token.json = {lexeme.kind, lexeme.begin, lexeme.end, lexeme.escapes};
+        if (lexeme.kind == lex::token_kind::Integer) {
+          auto checked = lex::check_integer(src, lexeme.begin, lexeme.end);
+          if (!checked.error.empty())
+            return {result.count, checked.error, checked.error_position};
+          token.json.value = checked.value;
+        }
+      } else if (c != '.' && c != '[' && c != ']' && c != '(' && c != ')' &&
+                 c != '|')
+        return {result.count, "Unrecognized token", pos};
+      if (tokens)
+        tokens[result.count] = token;
+      ++result.count;
+      pos = token.json.end;
+    }
+  }
+
+  /// @brief The tokens of the query Src, read as ctjson::detail::token_table
+  /// reads those of a document.
+  template <fixed_string Src>
+  struct token_table {
+    static constexpr auto scanned = tokenize(Src);
+    static constexpr auto size = scanned.count;
+    static constexpr std::string_view error = scanned.error;
+
+    static consteval auto read() noexcept {
+      std::array<token_info, size> tokens{};
+      tokenize(Src, tokens.data());
+      return tokens;
+    }
+    static constexpr auto tokens = read();
+
+    using error_token =
+        ErrorToken<ctjson::detail::to_fixed_string<error>(),
+                   scanned.error_position>;
+
+    template <std::size_t I>
+    static consteval auto get_token() noexcept {
+      constexpr auto token = tokens[I];
+      if constexpr (token.word)
+        return KeywordToken<Src.template slice<token.json.begin,
+                                               token.json.end>()>{};
+      else
+        return ctjson::detail::make_token<Src, token.json>();
+    }
+  };
+
+} // namespace detail
+
+template <fixed_string Src>
+struct Tokenizer {
+ private:
+  using table = detail::token_table<Src>;
+
+  template <std::size_t... I>
+  static consteval auto sequence(std::index_sequence<I...>) noexcept {
+    return TokenSequence<decltype(table::template get_token<I>())...>{};
+  }
+
+  static consteval auto get_result() noexcept {
+    if constexpr (!table::error.empty())
+      return typename table::error_token{};
+    else
+      return sequence(std::make_index_sequence<table::size>{});
+  }
+
+ public:
+  using result = decltype(get_result());
+};
+
+namespace detail {
+
+  // The value given by `.name` and `[n]` when there is nothing there.
+  inline const dom::Value null_value{};
+
+} // namespace detail
+
+/// @brief Gives the member `Key` of an object. The position of the member is
+/// remembered along with the object, and reused for the following objects of
+/// the same shape, which costs a pointer comparison instead of a key search.
+template <fixed_string Key>
+class Field {
+ public:
+  template <typename Next>
+  void operator()(const dom::Value &value, Next &&next) {
+    if (value.is_null()) {
+      next(detail::null_value);
+      return;
+    }
+    if (!value.is_object())
+      return;
+    const auto &object = value.as_object();
+    if (!m_last || !object.same_shape(*m_last)) {
+      m_last = &object;
+      m_index = index_in(object);
+    }
+    next(m_index < object.size() ? object.value(m_index) : detail::null_value);
+  }
+
+ private:
+  static std::size_t index_in(const dom::Object &object) noexcept {
+    for (std::size_t i = 0; i != object.size(); ++i)
+      if (object.key(i) == Key.to_string_view())
+        return i;
+    return object.size();
+  }
+
+  const dom::Object *m_last = nullptr;
+  std::size_t m_index = 0;
+};
+
+/// @brief Gives every element of an array or every value of an object.
+struct Iterate {
+  template <typename Next>
+  void operator()(const dom::Value &value, Next &&next) const {
+    if (value.is_array())
+      for (const auto &element : value.as_array())
+        next(element);
+    else if (value.is_object()) {
+      const auto &object = value.as_object();
+      for (std::size_t i = 0; i != object.size(); ++i)
+        next(object.value(i));
+    }
+  }
+};
+
+/// @brief Gives the element N of an array, counting from the end if N is
+/// negative.
+template <int N>
+struct Index {
+  template <typename Next>
+  void operator()(const dom::Value &value, Next &&next) const {
+    if (value.is_null()) {
+      next(detail::null_value);
+      return;
+    }
+    if (!value.is_array())
+      return;
+    const auto &elements = value.as_array();
+    auto size = static_cast<std::ptrdiff_t>(elements.size());
+    auto i = N < 0 ? size + N : std::ptrdiff_t{N};
+    next(i >= 0 && i < size ? elements[static_cast<std::size_t>(i)]
+                            : detail::null_value);
+  }
+};
+
+struct Truthy {
+  static bool test(const dom::Value &value) noexcept {
+    return !value.is_null() && value.kind() != dom::Kind::False;
+  }
+};
+
+template <fixed_string Op, CValue Literal>
+struct Compare {
+  static bool test(const dom::Value &value) noexcept {
+    if constexpr (Op == fixed_string("=="))
+      return dom::equals<Literal>(value);
+    else if constexpr (Op == fixed_string("!="))
+      return !dom::equals<Literal>(value);
+    else if constexpr (Op == fixed_string("<"))
+      return order(value) < 0;
+    else if constexpr (Op == fixed_string("<="))
+      return order(value) <= 0;
+    else if constexpr (Op == fixed_string(">"))
+      return order(value) > 0;
+    else
+      return order(value) >= 0;
+  }
+
+ private:
+  static std::partial_ordering order(const dom::Value &value) noexcept {
+    if constexpr (ctjson::detect::is_integer_token<Literal>) {
+      if (value.is_integer())
+        return value.as_integer() <=> Literal::value;
+    } else {
+      if (value.is_string())
+        return std::string_view(value.as_string()) <=>
+               Literal::value.to_string_view();
+    }
+    return std::partial_ordering::unordered;
+  }
+};
+
+template <typename... Stages>
+struct Pipeline;
+
+/// @brief Passes on its input for every output of Path that satisfies
+/// Condition.
+template <typename Path, typename Condition>
+class Select {
+ public:
+  template <typename Next>
+  void operator()(const dom::Value &value, Next &&next) {
+    Path::run_from(m_path, value, [&](const dom::Value &output) {
+      if (Condition::test(output))
+        next(value);
+    });
+  }
+
+ private:
+  typename Path::stages_type m_path;
+};
+
+template <typename... Stages>
+struct Pipeline {
+  // The stages keep what they remember between values, so they are made
+  // anew for every run.
+  using stages_type = std::tuple<Stages...>;
+
+  template <std::size_t I = 0, typename Sink>
+  static void run_from(stages_type &stages, const dom::Value &value,
+                       Sink &&sink) {
+    if constexpr (I == sizeof...(Stages))
+      sink(value);
+    else
+      std::get<I>(stages)(value, [&](const dom::Value &output) {
+        run_from<I + 1>(stages, output, sink);
+      });
+  }
+
+  /// @brief Calls sink with every output for `value`, in order.
+  template <typename Sink>
+  static void run(const dom::Value &value, Sink &&sink) {
+    stages_type stages;
+    run_from(stages, value, sink);
+  }
+};
+
+namespace detect {
+
+  template <typename T>
+  inline constexpr auto is_pipeline = false;
+  template <typename... Stages>
+  inline constexpr auto is_pipeline<Pipeline<Stages...>> = true;
+
+  template <typename T>
+  inline constexpr auto is_name_token = false;
+  template <fixed_string S>
+  inline constexpr auto is_name_token<KeywordToken<S>> = is_name_start(S[0]);
+
+  template <typename T>
+  inline constexpr auto is_operator_token =
+      ctjson::detect::is_keyword_token<T> && !is_name_token<T>;
+
+  template <typename T>
+  inline constexpr auto is_literal =
+      ctjson::detect::is_string_token<T> ||
+      ctjson::detect::is_integer_token<T> ||
+      std::is_same_v<T, True> || std::is_same_v<T, False> ||
+      std::is_same_v<T, Null>;
+
+} // namespace detect
+
+namespace detail {
+
+  template <typename... A, typename... B>
+  Pipeline<A..., B...> concat(Pipeline<A...>, Pipeline<B...>);
+
+} // namespace detail
+
+template <meta::specialization_of<TokenSequence> Tokens>
+struct ParseQuery {
+  template <std::size_t N>
+  struct nth_token_impl {
+    static constexpr auto get_result() noexcept {
+      if constexpr (N < Tokens::size)
+        return typename Tokens::template nth<N>::type{};
+      else
+        return EndOfTokens{};
+    }
+    using result = decltype(get_result());
+  };
+
+  template <std::size_t N>
+  using nth_token = typename nth_token_impl<N>::result;
+
+  template <typename Node, std::size_t NextPos = static_cast<std::size_t>(-1)>
+  struct internal_result_t {
+    static_assert(!(!ctjson::detect::is_syntax_error<Node> &&
+                    NextPos == static_cast<std::size_t>(-1)));
+    using node = Node;
+    static constexpr auto next_pos = NextPos;
+  };
+
+  template <fixed_string Msg, std::size_t Pos>
+  using error_result_t = internal_result_t<SyntaxError<Msg, Pos>>;
+
+  template <std::size_t Pos, typename... Stages>
+  struct suffixes_parser;
+
+  template <std::size_t Pos>
+  struct term_parser;
+
+  template <std::size_t Pos>
+  struct select_parser;
+
+  template <std::size_t Pos, typename Parsed>
+  struct pipeline_parser;
+
+  using result = typename pipeline_parser<0, Pipeline<>>::result;
+};
+
+template <meta::specialization_of<TokenSequence> Tokens>
+template <std::size_t Pos, typename... Stages>
+struct ParseQuery<Tokens>::suffixes_parser {
+  static consteval auto match_name() noexcept {
+    using name = nth_token<Pos + 1>;
+    if constexpr (!detect::is_name_token<name>)
+      return error_result_t<"expects name", Pos + 1>{};
+    else
+      return typename suffixes_parser<Pos + 2, Stages...,
+                                      Field<name::to_fixed_string()>>::result{};
+  }
+  static consteval auto match_bracket() noexcept {
+    using inside = nth_token<Pos + 1>;
+    if constexpr (std::is_same_v<inside, RBracket>)
+      return typename suffixes_parser<Pos + 2, Stages..., Iterate>::result{};
+    else if constexpr (!ctjson::detect::is_integer_token<inside>)
+      return error_result_t<"expects ']' or Integer", Pos + 1>{};
+    else if constexpr (!std::is_same_v<nth_token<Pos + 2>, RBracket>)
+      return error_result_t<"expects ']'", Pos + 2>{};
+    else
+      return typename suffixes_parser<Pos + 3, Stages...,
+                                      Index<inside::value>>::result{};
+  }
+  static consteval auto do_parse() noexcept {
+    using lookahead = nth_token<Pos>;
+    if constexpr (std::is_same_v<lookahead, Dot>)
+      return match_name();
+    else if constexpr (std::is_same_v<lookahead, LBracket>)
+      return match_bracket();
+    else
+      return internal_result_t<Pipeline<Stages...>, Pos>{};
+  }
+  using result = decltype(do_parse());
+};
+
+template <meta::specialization_of<TokenSequence> Tokens>
+template <std::size_t Pos>
+struct ParseQuery<Tokens>::term_parser {
+  static consteval auto do_parse() noexcept {
+    using lookahead = nth_token<Pos>;
+    if constexpr (std::is_same_v<lookahead, KeywordToken<"select">>)
+      return typename select_parser<Pos>::result{};
+    else if constexpr (!std::is_same_v<lookahead, Dot>)
+      return error_result_t<"expects '.' or 'select'", Pos>{};
+    else if constexpr (detect::is_name_token<nth_token<Pos + 1>>)
+      return typename suffixes_parser<
+          Pos + 2, Field<nth_token<Pos + 1>::to_fixed_string()>>::result{};
+    else if constexpr (std::is_same_v<nth_token<Pos + 1>, Dot>)
+      return error_result_t<"expects name", Pos + 1>{};
+    else
+      return typename suffixes_parser<Pos + 1>::result{};
+  }
+  using result = decltype(do_parse());
+};
+
+template <meta::specialization_of<TokenSequence> Tokens>
+template <std::size_t Pos>
+struct ParseQuery<Tokens>::select_parser {
+  static consteval auto do_parse() noexcept {
+    if constexpr (!std::is_same_v<nth_token<Pos + 1>, LParen>)
+      return error_result_t<"expects '('", Pos + 1>{};
+    else {
+      using path_result = typename term_parser<Pos + 2>::result;
+      using path = typename path_result::node;
+      if constexpr (ctjson::detect::is_syntax_error<path>)
+        return path_result{};
+      else
+        return match_condition<path, path_result::next_pos>();
+    }
+  }
+  template <typename Path, std::size_t Next>
+  static consteval auto match_condition() noexcept {
+    using lookahead = nth_token<Next>;
+    if constexpr (std::is_same_v<lookahead, RParen>)
+      return internal_result_t<Pipeline<Select<Path, Truthy>>, Next + 1>{};
+    else if constexpr (!detect::is_operator_token<lookahead>)
+      return error_result_t<"expects ')' or operator", Next>{};
+    else
+      return match_literal<Path, lookahead::to_fixed_string(), Next + 1>();
+  }
+  template <typename Path, fixed_string Op, std::size_t Next>
+  static consteval auto match_literal() noexcept {
+    using literal = nth_token<Next>;
+    constexpr auto ordering = Op != fixed_string("==") &&
+                              Op != fixed_string("!=");
+    if constexpr (!detect::is_literal<literal>)
+      return error_result_t<"expects literal", Next>{};
+    else if constexpr (ordering && !ctjson::detect::is_integer_token<literal> &&
+                       !ctjson::detect::is_string_token<literal>)
+      return error_result_t<"expects Integer or String", Next>{};
+    else if constexpr (!std::is_same_v<nth_token<Next + 1>, RParen>)
+      return error_result_t<"expects ')'", Next + 1>{};
+    else
+      return internal_result_t<Pipeline<Select<Path, Compare<Op, literal>>>,
+                               Next + 2>{};
+  }
+  using result = decltype(do_parse());
+};
+
+template <meta::specialization_of<TokenSequence> Tokens>
+template <std::size_t Pos, typename Parsed>
+struct ParseQuery<Tokens>::pipeline_parser {
+  static consteval auto do_parse() noexcept {
+    using term_result = typename term_parser<Pos>::result;
+    using term = typename term_result::node;
+    if constexpr (ctjson::detect::is_syntax_error<term>)
+      return term_result{};
+    else {
+      constexpr auto next_pos = term_result::next_pos;
+      using parsed = decltype(detail::concat(Parsed{}, term{}));
+      if constexpr (std::is_same_v<nth_token<next_pos>, Pipe>)
+        return typename pipeline_parser<next_pos + 1, parsed>::result{};
+      else
+        return internal_result_t<parsed, next_pos>{};
+    }
+  }
+  using result = decltype(do_parse());
+};
+
+/// @brief The Pipeline of the query Src, or the ErrorToken or SyntaxError
+/// that stops it from compiling.
+template <fixed_string Src>
+struct parse {
+  static consteval auto get_result() noexcept {
+    using tokenize_result = typename Tokenizer<Src>::result;
+    if constexpr (ctjson::detect::is_error_token<tokenize_result>)
+      return tokenize_result{};
+    else {
+      using parse_result = typename ParseQuery<tokenize_result>::result;
+      using root_node = typename parse_result::node;
+      constexpr auto next_pos = parse_result::next_pos;
+      if constexpr (ctjson::detect::is_syntax_error<root_node>)
+        return root_node{};
+      else if constexpr (next_pos < tokenize_result::size)
+        return SyntaxError<"expects end of string", next_pos>{};
+      else
+        return root_node{};
+    }
+  }
+  using result = decltype(get_result());
+};
+
+template <fixed_string Src>
+  requires detect::is_pipeline<typename parse<Src>::result>
+using compiled = typename parse<Src>::result;
+
+/// @brief Calls f with every output of the query Src on `value`, in order.
+template <fixed_string Src, typename F>
+inline void for_each(const dom::Value &value, F &&f) {
+  compiled<Src>::run(value, f);
+}
+
+/// @brief The outputs of the query Src on `value`, which point into `value`
+/// or to a static null.
+template <fixed_string Src>
+inline std::vector<const dom::Value *> collect(const dom::Value &value) {
+  std::vector<const dom::Value *> outputs;
+  compiled<Src>::run(value, [&](const dom::Value &output) {
+    outputs.push_back(&output);
+  });
+  return outputs;
+}
+
+} // namespace gkxx::ctjson::query
+
+#endif // GKXX_CTJSON_QUERY_HPP
@@ -0,0 +1,432 @@
+#ifndef GKXX_CTJSON_SCHEMA_HPP
+#define GKXX_CTJSON_SCHEMA_HPP
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "ctjson.hpp"
+#include "dom.hpp"
+#include "type_id.hpp"
+
+/*
+Supported subset of JSON Schema, written as a ctjson document:
+  "type":       "object" | "array" | "string" | "integer" | "boolean" | "null"
+  "enum":       [values...]
+  "minimum", "maximum":   Integer bounds (inclusive)
+  "minItems", "maxItems": Array length bounds (inclusive)
+  "items":      {schema} applied to every element of an Array
+  "required":   [keys...] that an Object must have
+  "properties": {"key": {schema}, ...} applied to the members of an Object
+Any other keyword is rejected.
+ */
+
+namespace gkxx::ctjson {
+
+namespace detail {
+
+  struct absent_keyword {};
+
+  template <typename Schema, fixed_string Keyword>
+  struct schema_keyword_impl {
+    using type = absent_keyword;
+  };
+
+  template <CMember... Members, fixed_string Keyword>
+    requires Object<Members...>::template contains<Keyword>
+  struct schema_keyword_impl<Object<Members...>, Keyword> {
+    using type = typename Object<Members...>::template get<Keyword>;
+  };
+
+  template <typename Schema, fixed_string Keyword>
+  using schema_keyword = typename schema_keyword_impl<Schema, Keyword>::type;
+
+  template <typename Schema, fixed_string Keyword>
+  inline constexpr auto has_keyword =
+      !std::is_same_v<schema_keyword<Schema, Keyword>, absent_keyword>;
+
+  template <typename Schema, fixed_string Keyword, typename Default>
+  using schema_keyword_or =
+      std::conditional_t<has_keyword<Schema, Keyword>,
+                         schema_keyword<Schema, Keyword>, Default>;
+
+  inline constexpr bool is_known_keyword(std::string_view keyword) noexcept {
+    for (auto known : {"type", "enum", "minimum", "maximum", "minItems",
+                       "maxItems", "items", "required", "properties"})
+      if (keyword == known)
+        return true;
+    return false;
+  }
+
+  inline constexpr bool type_accepts(std::string_view type,
+                                     dom::Kind kind) noexcept {
+    using enum dom::Kind;
+    if (type == "object")
+      return kind == Object;
+    if (type == "array")
+      return kind == Array;
+    if (type == "string")
+      return kind == String;
+    if (type == "integer")
+      return kind == Integer;
+    if (type == "boolean")
+      return kind == True || kind == False;
+    return kind == Null; // "null"
+  }
+
+  inline constexpr bool is_known_type(std::string_view type) noexcept {
+    for (auto known :
+         {"object", "array", "string", "integer", "boolean", "null"})
+      if (type == known)
+        return true;
+    return false;
+  }
+
+  template <typename T>
+  inline constexpr auto is_string_array = false;
+  template <fixed_string... Ss>
+  inline constexpr auto is_string_array<Array<String<Ss>...>> =
+      !has_duplicate<Ss...>;
+
+  template <typename T>
+  inline constexpr auto is_optional_integer =
+      std::is_same_v<T, absent_keyword> || detect::is_integer_token<T>;
+
+  template <typename Bound>
+  inline constexpr bool at_least(long long n) noexcept {
+    if constexpr (std::is_same_v<Bound, absent_keyword>)
+      return true;
+    else
+      return n >= Bound::value;
+  }
+
+  template <typename Bound>
+  inline constexpr bool at_most(long long n) noexcept {
+    if constexpr (std::is_same_v<Bound, absent_keyword>)
+      return true;
+    else
+      return n <= Bound::value;
+  }
+
+  // Whether two compile-time values are equal as JSON values. Like
+  // dom::equals, Object members are compared regardless of their order.
+  template <typename A, typename B>
+  inline constexpr auto same_value = std::is_same_v<A, B>;
+
+  template <typename Obj, CMember M>
+  consteval bool has_same_member() noexcept {
+    if constexpr (Obj::template contains<M::key>)
+      return same_value<typename M::value,
+                        typename Obj::template get<M::key>>;
+    else
+      return false;
+  }
+
+  template <CValue... As, CValue... Bs>
+    requires(sizeof...(As) == sizeof...(Bs))
+  inline constexpr auto same_value<Array<As...>, Array<Bs...>> =
+      (same_value<As, Bs> && ...);
+
+  template <CMember... As, CMember... Bs>
+    requires(sizeof...(As) == sizeof...(Bs))
+  inline constexpr auto same_value<Object<As...>, Object<Bs...>> =
+      (has_same_member<Object<Bs...>, As>() && ...);
+
+  template <CValue Schema>
+  struct schema_traits {
+    static_assert(meta::is_specialization_of_v<Schema, Object>,
+                  "a schema must be an Object");
+
+    template <CMember... Members>
+    static consteval bool known_keywords(Object<Members...>) noexcept {
+      return (is_known_keyword(Members::key.to_string_view()) && ...);
+    }
+    static_assert(known_keywords(Schema{}), "unsupported schema keyword");
+
+    using type = schema_keyword<Schema, "type">;
+    static consteval bool check_type() noexcept {
+      if constexpr (std::is_same_v<type, absent_keyword>)
+        return true;
+      else if constexpr (detect::is_string_token<type>)
+        return is_known_type(type::value.to_string_view());
+      else
+        return false;
+    }
+    static_assert(check_type(), "\"type\" must be the name of a JSON type");
+
+    using enum_values = schema_keyword_or<Schema, "enum", void>;
+    static_assert(std::is_void_v<enum_values> ||
+                      meta::is_specialization_of_v<enum_values, Array>,
+                  "\"enum\" must be an Array");
+
+    using minimum = schema_keyword<Schema, "minimum">;
+    using maximum = schema_keyword<Schema, "maximum">;
+    using min_items = schema_keyword<Schema, "minItems">;
+    using max_items = schema_keyword<Schema, "maxItems">;
+    static_assert(is_optional_integer<minimum> &&
+                      is_optional_integer<maximum> &&
+                      is_optional_integer<min_items> &&
+                      is_optional_integer<max_items>,
+                  "bounds must be Integers");
+
+    using items = schema_keyword_or<Schema, "items", void>;
+
+    using required = schema_keyword_or<Schema, "required", Array<>>;
+    static_assert(is_string_array<required>,
+                  "\"required\" must be an Array of distinct Strings");
+
+    using properties = schema_keyword_or<Schema, "properties", Object<>>;
+    static_assert(meta::is_specialization_of_v<properties, Object>,
+                  "\"properties\" must be an Object");
+  };
+
+  template <CValue Schema, CValue Doc>
+  struct schema_matcher {
+    using traits = schema_traits<Schema>;
+
+    static consteval bool check_type() noexcept {
+      if constexpr (std::is_same_v<typename traits::type, absent_keyword>)
+        return true;
+      else
+        return type_accepts(traits::type::value.to_string_view(),
+                            dom::kind_of<Doc>);
+    }
+
+    template <CValue... Values>
+    static consteval bool in_enum(Array<Values...>) noexcept {
+      return (same_value<Doc, Values> || ...);
+    }
+    static consteval bool check_enum() noexcept {
+      if constexpr (std::is_void_v<typename traits::enum_values>)
+        return true;
+      else
+        return in_enum(typename traits::enum_values{});
+    }
+
+    template <typename T>
+    struct elements;
+
+    template <CValue... Values>
+    struct elements<Array<Values...>> {
+      static constexpr auto size = sizeof...(Values);
+      template <typename Items>
+      static constexpr bool all_match = (schema_matcher<Items, Values>::value &&
+                                         ...);
+    };
+
+    template <typename T>
+    struct members;
+
+    template <CMember... Members>
+    struct members<Object<Members...>> {
+      template <fixed_string... Keys>
+      static consteval bool has_all(Array<String<Keys>...>) noexcept {
+        return (Doc::template contains<Keys> && ...);
+      }
+
+      template <CMember M>
+      static consteval bool member_matches() noexcept {
+        using properties = typename traits::properties;
+        if constexpr (properties::template contains<M::key>)
+          return schema_matcher<
+              typename properties::template get<M::key>,
+              typename M::value>::value;
+        else
+          return true;
+      }
+      static constexpr bool all_match = (member_matches<Members>() && ...);
+    };
+
+    static consteval bool check_contents() noexcept {
+      if constexpr (detect::is_integer_token<Doc>)
+        return at_least<typename traits::minimum>(Doc::value) &&
+               at_most<typename traits::maximum>(Doc::value);
+      else if constexpr (meta::is_specialization_of_v<Doc, Array>) {
+        constexpr auto size = static_cast<long long>(elements<Doc>::size);
+        if constexpr (!std::is_void_v<typename traits::items>) {
+          if (!elements<Doc>::template all_match<typename traits::items>)
+            return false;
+        }
+        return at_least<typename traits::min_items>(size) &&
+               at_most<typename traits::max_items>(size);
+      } else if constexpr (meta::is_specialization_of_v<Doc, Object>)
+        return members<Doc>::has_all(typename traits::required{}) &&
+               members<Doc>::all_match;
+      else
+        return true;
+    }
+
+    static constexpr bool value =
+        check_type() && check_enum() && check_contents();
+  };
+
+} // namespace detail
+
+/// @brief Whether the compile-time document Doc satisfies Schema, e.g.
+/// static_assert(matches_schema<schema, parse<config>::result>);
+template <CValue Schema, CValue Doc>
+inline constexpr bool matches_schema =
+    detail::schema_matcher<Schema, Doc>::value;
+
+/// @brief A runtime validator specialized for Schema: every keyword is
+/// resolved at compile time, and the members of an Object are looked up in a
+/// collision-free table built from the keys of "properties" and "required".
+template <CValue Schema>
+struct schema_validator {
+ private:
+  using traits = detail::schema_traits<Schema>;
+
+  using validate_fn = bool (*)(const dom::Value &) noexcept;
+
+  static bool accept_any(const dom::Value &) noexcept {
+    return true;
+  }
+
+  struct key_entry {
+    std::string_view key;
+    std::uint64_t hash = 0;
+    validate_fn validate = nullptr;
+    int required_index = -1;
+  };
+
+  template <typename Properties, typename Required>
+  struct key_table;
+
+  template <CMember... Properties, fixed_string... Required>
+  struct key_table<Object<Properties...>, Array<String<Required>...>> {
+    static constexpr auto extra_required =
+        ((Object<Properties...>::template contains<Required> ? 0 : 1) + ... +
+         0);
+    static constexpr auto size = sizeof...(Properties) + extra_required;
+    static constexpr auto required_count = sizeof...(Required);
+
+    template <fixed_string Key>
+    static consteval int required_index() noexcept {
+      int index = 0;
+      bool found = ((Key == Required ? true : (++index, false)) || ...);
+      return found ? index : -1;
+    }
+
+    static consteval auto make_entries() noexcept {
+      std::array<key_entry, size> result{};
+      std::size_t i = 0;
+      ((result[i++] = {Properties::key.to_string_view(), 0,
+                       &schema_validator<
+                           typename Properties::value>::validate_value,
+                       required_index<Properties::key>()}),
+       ...);
+      (
+          [&] {
+            if constexpr (!Object<Properties...>::template contains<
+                              Required>)
+              result[i++] = {String<Required>::value.to_string_view(), 0,
+                             &accept_any, required_index<Required>()};
+          }(),
+          ...);
+      for (auto &entry : result)
+        entry.hash = gkxx::detail::fnv1a(entry.key);
+      return result;
+    }
+    static constexpr auto entries = make_entries();
+
+    static consteval auto make_hashes() noexcept {
+      std::array<std::uint64_t, size> result{};
+      for (std::size_t i = 0; i != size; ++i)
+        result[i] = entries[i].hash;
+      return result;
+    }
+    static constexpr auto layout = gkxx::detail::make_slot_layout<
+        gkxx::detail::initial_capacity(size), make_hashes()>();
+    static_assert(layout.found, "cannot build a key table for this schema");
+
+    static constexpr std::size_t slot_of(std::uint64_t hash) noexcept {
+      return (hash >> layout.shift) & (layout.capacity - 1);
+    }
+
+    // Empty slots keep an empty key and a zero hash, which no real key can
+    // match on both.
+    static constexpr auto slots = [] {
+      std::array<key_entry, layout.capacity> result{};
+      for (const auto &entry : entries)
+        result[slot_of(entry.hash)] = entry;
+      return result;
+    }();
+
+    static const key_entry *find(std::string_view key) noexcept {
+      auto hash = gkxx::detail::fnv1a(key);
+      const auto &slot = slots[slot_of(hash)];
+      return slot.hash == hash && slot.key == key ? &slot : nullptr;
+    }
+  };
+
+  using table = key_table<typename traits::properties,
+                          typename traits::required>;
+
+  template <CValue... Values>
+  static bool in_enum(const dom::Value &v, Array<Values...>) noexcept {
+    return (dom::equals<Values>(v) || ...);
+  }
+
+  static bool validate_object(const dom::Object &object) noexcept {
+    std::bitset<table::required_count> seen;
+    for (const auto &member : object) {
+      if constexpr (table::size > 0) {
+        if (auto entry = table::find(member.key)) {
+          if (!entry->validate(member.value))
+            return false;
+          if (entry->required_index >= 0)
+            seen.set(static_cast<std::size_t>(entry->required_index));
+        }
+      }
+    }
+    return seen.all();
+  }
+
+  static bool validate_array(const dom::Array &array) noexcept {
+    auto size = static_cast<long long>(array.size());
+    if (!detail::at_least<typename traits::min_items>(size) ||
+        !detail::at_most<typename traits::max_items>(size))
+      return false;
+    if constexpr (!std::is_void_v<typename traits::items>) {
+      for (const auto &element : array)
+        if (!schema_validator<typename traits::items>::validate_value(element))
+          return false;
+    }
+    return true;
+  }
+
+ public:
+  static bool validate_value(const dom::Value &v) noexcept {
+    if constexpr (!std::is_same_v<typename traits::type,
+                                  detail::absent_keyword>) {
+      if (!detail::type_accepts(traits::type::value.to_string_view(),
+                                v.kind()))
+        return false;
+    }
+    if constexpr (!std::is_void_v<typename traits::enum_values>) {
+      if (!in_enum(v, typename traits::enum_values{}))
+        return false;
+    }
+    switch (v.kind()) {
+    case dom::Kind::Integer:
+      return detail::at_least<typename traits::minimum>(v.as_integer()) &&
+             detail::at_most<typename traits::maximum>(v.as_integer());
+    case dom::Kind::Array:
+      return validate_array(v.as_array());
+    case dom::Kind::Object:
+      return validate_object(v.as_object());
+    default:
+      return true;
+    }
+  }
+
+  bool operator()(const dom::Value &v) const noexcept {
+    return validate_value(v);
+  }
+};
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_SCHEMA_HPP
@@ -0,0 +1,415 @@
+#ifndef GKXX_CTJSON_SERIALIZE_HPP
+#define GKXX_CTJSON_SERIALIZE_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "ctjson.hpp"
+
+/*
+The output shape of serialize<Schema> is a ctjson document:
+  "string", "integer", "boolean"  a field of that type
+  {"key": {shape}, ...}           a struct (or tuple-like type) whose fields,
+                                  in order, have the shapes of the members
+  [{shape}]                       a range whose elements have that shape
+For example,
+  {"name": "string", "id": "integer", "tags": ["string"]}
+describes struct { std::string name; int id; std::vector<std::string> tags; }.
+
+The shape is compiled into a sequence of operations, in which all the bytes
+that do not depend on the value (braces, keys, quotes and commas) are joined
+into as few fixed_string fragments as possible.
+ */
+
+namespace gkxx::ctjson {
+
+namespace detail::ser {
+
+  struct string_tag {};
+  struct integer_tag {};
+  struct boolean_tag {};
+
+  // The I-th of the N fields of a struct.
+  template <std::size_t I, std::size_t N>
+  struct step {};
+
+  template <typename... Steps>
+  struct path {};
+
+  template <fixed_string S>
+  struct lit {
+    static constexpr auto value = S;
+  };
+
+  template <typename Tag, typename Path>
+  struct field {};
+
+  template <typename ElementOps, typename Path>
+  struct loop {};
+
+  template <typename... Ops>
+  struct ops {};
+
+  template <typename... Ts>
+  struct cat;
+
+  template <>
+  struct cat<> {
+    using type = ops<>;
+  };
+
+  template <typename... Os>
+  struct cat<ops<Os...>> {
+    using type = ops<Os...>;
+  };
+
+  template <typename... As, typename... Bs, typename... Rest>
+  struct cat<ops<As...>, ops<Bs...>, Rest...> {
+    using type = typename cat<ops<As..., Bs...>, Rest...>::type;
+  };
+
+  // Joins adjacent literal fragments.
+  template <typename Done, typename... Todo>
+  struct join {
+    using type = Done;
+  };
+
+  template <typename... Done, fixed_string A, fixed_string B,
+            typename... Todo>
+  struct join<ops<Done...>, lit<A>, lit<B>, Todo...> {
+    using type = typename join<ops<Done...>, lit<A + B>, Todo...>::type;
+  };
+
+  template <typename... Done, typename Op, typename... Todo>
+  struct join<ops<Done...>, Op, Todo...> {
+    using type = typename join<ops<Done..., Op>, Todo...>::type;
+  };
+
+  template <typename Ops>
+  struct joined;
+
+  template <typename... Os>
+  struct joined<ops<Os...>> {
+    using type = typename join<ops<>, Os...>::type;
+  };
+
+  template <typename Path, typename Step>
+  struct append_step;
+
+  template <typename... Steps, typename Step>
+  struct append_step<path<Steps...>, Step> {
+    using type = path<Steps..., Step>;
+  };
+
+  inline constexpr char hex_digits[] = "0123456789abcdef";
+
+  // Other control characters have no short escape and are written as \u00XX,
+  // which the parsers read back.
+  constexpr bool is_control(char c) noexcept {
+    return static_cast<unsigned char>(c) < 0x20;
+  }
+
+  template <fixed_string S>
+  consteval auto escaped() noexcept {
+    constexpr auto length = [] {
+      std::size_t n = 0;
+      for (auto c : S.to_string_view())
+        n += (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t')
+                 ? 2
+             : is_control(c) ? 6
+                             : 1;
+      return n;
+    }();
+    char data[length + 1]{};
+    std::size_t fill = 0;
+    for (auto c : S.to_string_view()) {
+      switch (c) {
+      case '"':
+      case '\\':
+        data[fill++] = '\\';
+        data[fill++] = c;
+        break;
+      case '\n':
+        data[fill++] = '\\';
+        data[fill++] = 'n';
+        break;
+      case '\r':
+        data[fill++] = '\\';
+        data[fill++] = 'r';
+        break;
+      case '\t':
+        data[fill++] = '\\';
+        data[fill++] = 't';
+        break;
+      default:
+        if (is_control(c)) {
+          for (auto e : {'\\', 'u', '0', '0'})
+            data[fill++] = e;
+          data[fill++] = hex_digits[c >> 4];
+          data[fill++] = hex_digits[c & 0xf];
+        } else
+          data[fill++] = c;
+      }
+    }
+    return fixed_string<length>(data);
+  }
+
+  template <CValue Shape, typename Path>
+  struct compile;
+
+  template <fixed_string S, typename Path>
+  struct compile<String<S>, Path> {
+    static_assert(S == fixed_string("string") || S == fixed_string("integer") ||
+                      S == fixed_string("boolean"),
+                  "a field must be \"string\", \"integer\" or \"boolean\"");
+    static consteval auto get() noexcept {
+      if constexpr (S == fixed_string("string"))
+        return ops<lit<"\"">, field<string_tag, Path>, lit<"\"">>{};
+      else if constexpr (S == fixed_string("integer"))
+        return ops<field<integer_tag, Path>>{};
+      else
+        return ops<field<boolean_tag, Path>>{};
+    }
+    using type = decltype(get());
+  };
+
+  template <CMember... Members, typename Path>
+  struct compile<Object<Members...>, Path> {
+    static constexpr auto N = sizeof...(Members);
+
+    template <std::size_t I, CMember M>
+    static consteval auto member() noexcept {
+      constexpr auto key = fixed_string("\"") + escaped<M::key>() + "\":";
+      using value_ops = typename compile<
+          typename M::value,
+          typename append_step<Path, step<I, N>>::type>::type;
+      if constexpr (I == 0)
+        return typename cat<ops<lit<key>>, value_ops>::type{};
+      else
+        return typename cat<ops<lit<"," + key>>, value_ops>::type{};
+    }
+
+    template <std::size_t... Is>
+    static consteval auto get(std::index_sequence<Is...>) noexcept {
+      return typename cat<ops<lit<"{">>, decltype(member<Is, Members>())...,
+                          ops<lit<"}">>>::type{};
+    }
+    using type = decltype(get(std::make_index_sequence<N>{}));
+  };
+
+  template <CValue Element, typename Path>
+  struct compile<Array<Element>, Path> {
+    using element_ops =
+        typename joined<typename compile<Element, path<>>::type>::type;
+    using type = ops<lit<"[">, loop<element_ops, Path>, lit<"]">>;
+  };
+
+  template <typename Ops>
+  struct size_estimate;
+
+  template <typename... Os>
+  struct size_estimate<ops<Os...>> {
+    template <typename Op>
+    struct of;
+    template <fixed_string S>
+    struct of<lit<S>> {
+      static constexpr std::size_t value = S.size();
+    };
+    template <typename Path>
+    struct of<field<string_tag, Path>> {
+      static constexpr std::size_t value = 16;
+    };
+    template <typename Path>
+    struct of<field<integer_tag, Path>> {
+      static constexpr std::size_t value = 11;
+    };
+    template <typename Path>
+    struct of<field<boolean_tag, Path>> {
+      static constexpr std::size_t value = 5;
+    };
+    // Guess a few elements per range.
+    template <typename ElementOps, typename Path>
+    struct of<loop<ElementOps, Path>> {
+      static constexpr std::size_t value =
+          4 * (size_estimate<ElementOps>::value + 1);
+    };
+    static constexpr std::size_t value = (of<Os>::value + ... + 0);
+  };
+
+  template <std::size_t N, typename T>
+  constexpr auto tie_fields(const T &t) noexcept {
+    static_assert(N <= 16, "structs with more than 16 fields are not supported");
+    if constexpr (N == 1) {
+      const auto &[a] = t;
+      return std::tie(a);
+    } else if constexpr (N == 2) {
+      const auto &[a, b] = t;
+      return std::tie(a, b);
+    } else if constexpr (N == 3) {
+      const auto &[a, b, c] = t;
+      return std::tie(a, b, c);
+    } else if constexpr (N == 4) {
+      const auto &[a, b, c, d] = t;
+      return std::tie(a, b, c, d);
+    } else if constexpr (N == 5) {
+      const auto &[a, b, c, d, e] = t;
+      return std::tie(a, b, c, d, e);
+    } else if constexpr (N == 6) {
+      const auto &[a, b, c, d, e, f] = t;
+      return std::tie(a, b, c, d, e, f);
+    } else if constexpr (N == 7) {
+      const auto &[a, b, c, d, e, f, g] = t;
+      return std::tie(a, b, c, d, e, f, g);
+    } else if constexpr (N == 8) {
+      const auto &[a, b, c, d, e, f, g, h] = t;
+      return std::tie(a, b, c, d, e, f, g, h);
+    } else if constexpr (N == 9) {
+      const auto &[a, b, c, d, e, f, g, h, i] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i);
+    } else if constexpr (N == 10) {
+      const auto &[a, b, c, d, e, f, g, h, i, j] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j);
+    } else if constexpr (N == 11) {
+      const auto &[a, b, c, d, e, f, g, h, i, j, k] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j, k);
+    } else if constexpr (N == 12) {
+      const auto &[a, b, c, d, e, f, g, h, i, j, k, l] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j, k, l);
+    } else if constexpr (N == 13) {
+      const auto &[a, b, c, d, e, f, g, h, i, j, k, l, m] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m);
+    } else if constexpr (N == 14) {
+      const auto &[a, b, c, d, e, f, g, h, i, j, k, l, m, n] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n);
+    } else if constexpr (N == 15) {
+      const auto &[a, b, c, d, e, f, g, h, i, j, k, l, m, n, o] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o);
+    } else {
+      const auto &[a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p] = t;
+      return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p);
+    }
+  }
+
+  template <typename T>
+  constexpr const T &get_path(const T &t, path<>) noexcept {
+    return t;
+  }
+
+  template <typename T, std::size_t I, std::size_t N, typename... Rest>
+  constexpr const auto &get_path(const T &t, path<step<I, N>, Rest...>) noexcept {
+    return get_path(std::get<I>(tie_fields<N>(t)), path<Rest...>{});
+  }
+
+  inline void write_escaped(std::string_view str, std::string &out) {
+    auto flushed = str.begin();
+    for (auto it = str.begin(); it != str.end(); ++it) {
+      const char *replacement;
+      char unicode[] = "\\u00XX";
+      std::size_t length = 2;
+      switch (*it) {
+      case '"':
+        replacement = "\\\"";
+        break;
+      case '\\':
+        replacement = "\\\\";
+        break;
+      case '\n':
+        replacement = "\\n";
+        break;
+      case '\r':
+        replacement = "\\r";
+        break;
+      case '\t':
+        replacement = "\\t";
+        break;
+      default:
+        if (!is_control(*it))
+          continue;
+        unicode[4] = hex_digits[*it >> 4];
+        unicode[5] = hex_digits[*it & 0xf];
+        replacement = unicode;
+        length = 6;
+      }
+      out.append(flushed, it);
+      out.append(replacement, length);
+      flushed = it + 1;
+    }
+    out.append(flushed, str.end());
+  }
+
+  template <typename T>
+  void run(ops<>, const T &, std::string &) {}
+
+  template <typename T, typename... Os>
+  void run(ops<Os...>, const T &value, std::string &out);
+
+  template <fixed_string S, typename T>
+  void run_op(lit<S>, const T &, std::string &out) {
+    out.append(S.data, S.size());
+  }
+
+  template <typename Path, typename T>
+  void run_op(field<string_tag, Path>, const T &value, std::string &out) {
+    write_escaped(std::string_view(get_path(value, Path{})), out);
+  }
+
+  template <typename Path, typename T>
+  void run_op(field<integer_tag, Path>, const T &value, std::string &out) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits),
+                                get_path(value, Path{}));
+    out.append(digits, result.ptr);
+  }
+
+  template <typename Path, typename T>
+  void run_op(field<boolean_tag, Path>, const T &value, std::string &out) {
+    if (get_path(value, Path{}))
+      out.append("true", 4);
+    else
+      out.append("false", 5);
+  }
+
+  template <typename ElementOps, typename Path, typename T>
+  void run_op(loop<ElementOps, Path>, const T &value, std::string &out) {
+    bool first = true;
+    for (const auto &element : get_path(value, Path{})) {
+      if (!first)
+        out.push_back(',');
+      first = false;
+      run(ElementOps{}, element, out);
+    }
+  }
+
+  template <typename T, typename... Os>
+  void run(ops<Os...>, const T &value, std::string &out) {
+    (run_op(Os{}, value, out), ...);
+  }
+
+} // namespace detail::ser
+
+/// @brief The compiled form of a serialization shape: the fragments and field
+/// writes it expands to, and a guess of the output size.
+template <CValue Schema>
+struct serializer {
+  using ops = typename detail::ser::joined<
+      typename detail::ser::compile<Schema, detail::ser::path<>>::type>::type;
+  static constexpr std::size_t size_estimate =
+      detail::ser::size_estimate<ops>::value;
+};
+
+/// @brief Appends the JSON form of value, shaped by Schema, to buffer. The
+/// buffer can be cleared and reused so that its capacity is kept.
+template <CValue Schema, typename T>
+void serialize(const T &value, std::string &buffer) {
+  using s = serializer<Schema>;
+  buffer.reserve(buffer.size() + s::size_estimate);
+  detail::ser::run(typename s::ops{}, value, buffer);
+}
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_SERIALIZE_HPP
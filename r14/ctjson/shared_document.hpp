@@ -0,0 +1,261 @@
+#ifndef GKXX_CTJSON_SHARED_DOCUMENT_HPP
+#define GKXX_CTJSON_SHARED_DOCUMENT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dom.hpp"
+#include "input.hpp"
+
+// A runtime document read by many threads and replaced from time to time.
+//
+// Every version is an immutable snapshot owning its arena. The current one is
+// published through an atomic pointer, and replaced ones are reclaimed with
+// hazard pointers: a reader announces the snapshot it is about to use in a
+// slot of its own and checks that it is still current, and a writer only frees
+// retired snapshots that no slot announces. Reading costs two atomic stores
+// and a load, and never locks or allocates; writers are serialized among
+// themselves only.
+
+namespace gkxx::ctjson {
+
+class document_snapshot {
+ public:
+  /// @throws dom::parse_error
+  explicit document_snapshot(std::string_view text)
+      : m_root{dom::parse(text, &m_arena)} {}
+
+  document_snapshot(const document_snapshot &) = delete;
+  document_snapshot &operator=(const document_snapshot &) = delete;
+
+  const dom::Value &root() const noexcept {
+    return m_root;
+  }
+  /// @brief 1 for the initial document, incremented by every publish.
+  std::uint64_t version() const noexcept {
+    return m_version;
+  }
+
+ private:
+  friend class shared_document;
+
+  std::pmr::monotonic_buffer_resource m_arena;
+  dom::Value m_root;
+  std::uint64_t m_version = 1;
+};
+
+class shared_document {
+  struct alignas(64) hazard_slot {
+    std::atomic<const document_snapshot *> pointer{nullptr};
+    std::atomic<bool> claimed{false};
+  };
+
+ public:
+  /// @brief Keeps the snapshot it was acquired for alive.
+  class read_guard {
+   public:
+    read_guard(read_guard &&other) noexcept
+        : m_slot{std::exchange(other.m_slot, nullptr)},
+          m_snapshot{other.m_snapshot} {}
+    read_guard &operator=(read_guard &&) = delete;
+    ~read_guard() {
+      if (m_slot)
+        m_slot->pointer.store(nullptr, std::memory_order_release);
+    }
+
+    const document_snapshot &snapshot() const noexcept {
+      return *m_snapshot;
+    }
+    const dom::Value &root() const noexcept {
+      return m_snapshot->root();
+    }
+    const dom::Value *operator->() const noexcept {
+      return &m_snapshot->root();
+    }
+
+   private:
+    friend class shared_document;
+    read_guard(hazard_slot *slot, const document_snapshot *snapshot) noexcept
+        : m_slot{slot}, m_snapshot{snapshot} {}
+
+    hazard_slot *m_slot;
+    const document_snapshot *m_snapshot;
+  };
+
+  /// @brief A hazard slot owned by one thread. It may hold one read_guard at a
+  /// time and must not outlive the document.
+  class reader {
+   public:
+    reader(reader &&other) noexcept
+        : m_document{other.m_document},
+          m_slot{std::exchange(other.m_slot, nullptr)} {}
+    reader &operator=(reader &&) = delete;
+    ~reader() {
+      if (m_slot)
+        m_slot->claimed.store(false, std::memory_order_release);
+    }
+
+    read_guard acquire() const noexcept {
+      auto snapshot = m_document->m_current.load();
+      while (true) {
+        m_slot->pointer.store(snapshot);
+        auto current = m_document->m_current.load();
+        if (current == snapshot)
+          return {m_slot, snapshot};
+        snapshot = current;
+      }
+    }
+
+   private:
+    friend class shared_document;
+    reader(const shared_document *document, hazard_slot *slot) noexcept
+        : m_document{document}, m_slot{slot} {}
+
+    const shared_document *m_document;
+    hazard_slot *m_slot;
+  };
+
+  /// @throws dom::parse_error
+  explicit shared_document(std::string_view text, std::size_t max_readers = 64)
+      : m_current{new document_snapshot{text}},
+        m_slots{std::make_unique<hazard_slot[]>(max_readers)},
+        m_slot_count{max_readers} {}
+
+  shared_document(const shared_document &) = delete;
+  shared_document &operator=(const shared_document &) = delete;
+
+  /// @brief All readers must have been destroyed.
+  ~shared_document() {
+    delete m_current.load();
+  }
+
+  /// @throws std::length_error if all max_readers slots are taken.
+  reader make_reader() {
+    for (std::size_t i = 0; i != m_slot_count; ++i) {
+      auto expected = false;
+      if (m_slots[i].claimed.compare_exchange_strong(expected, true))
+        return {this, &m_slots[i]};
+    }
+    throw std::length_error("shared_document: too many readers");
+  }
+
+  /// @brief Parses text and makes it the current document. Readers keep
+  /// seeing the previous one until they acquire again.
+  /// @throws dom::parse_error, leaving the current document in place.
+  void publish(std::string_view text) {
+    publish(std::make_unique<document_snapshot>(text));
+  }
+
+  void publish(std::unique_ptr<document_snapshot> snapshot) {
+    std::lock_guard lock{m_writer};
+    snapshot->m_version = m_current.load()->m_version + 1;
+    m_retired.emplace_back(m_current.exchange(snapshot.release()));
+    reclaim();
+  }
+
+  std::uint64_t version() const noexcept {
+    return m_current.load()->version();
+  }
+
+ private:
+  // Frees the retired snapshots that no reader announces. m_writer is held.
+  void reclaim() {
+    std::erase_if(m_retired, [this](const auto &snapshot) {
+      for (std::size_t i = 0; i != m_slot_count; ++i)
+        if (m_slots[i].pointer.load() == snapshot.get())
+          return false;
+      return true;
+    });
+  }
+
+  std::atomic<document_snapshot *> m_current;
+  std::unique_ptr<hazard_slot[]> m_slots;
+  std::size_t m_slot_count;
+  std::mutex m_writer;
+  std::vector<std::unique_ptr<document_snapshot>> m_retired;
+};
+
+/// @brief Polls a file and republishes the document whenever the file's
+/// modification time or size changes. Parsing happens on the watcher's own
+/// thread; errors are passed to the handler and the current document is kept.
+/// The file is read with input_source::read_file rather than mapped: a file
+/// truncated in place while it was mapped would raise SIGBUS, whereas a read
+/// at worst gives a torn document, which fails to parse or is replaced on the
+/// next change.
+class file_watcher {
+ public:
+  using error_handler = std::function<void(std::exception_ptr)>;
+
+  file_watcher(shared_document &document, std::filesystem::path path,
+               std::chrono::milliseconds interval = std::chrono::seconds{1},
+               error_handler on_error = {})
+      : m_document{document}, m_path{std::move(path)}, m_interval{interval},
+        m_on_error{std::move(on_error)}, m_stamp{stamp()},
+        m_thread{[this](std::stop_token stop) { watch(stop); }} {}
+
+  file_watcher(const file_watcher &) = delete;
+  file_watcher &operator=(const file_watcher &) = delete;
+
+ private:
+  struct file_stamp {
+    std::filesystem::file_time_type time{};
+    std::uintmax_t size = 0;
+    friend bool operator==(const file_stamp &, const file_stamp &) = default;
+  };
+
+  file_stamp stamp() const {
+    std::error_code ec;
+    file_stamp result{std::filesystem::last_write_time(m_path, ec)};
+    if (!ec)
+      result.size = std::filesystem::file_size(m_path, ec);
+    return ec ? file_stamp{} : result;
+  }
+
+  void watch(std::stop_token stop) {
+    std::mutex mutex;
+    std::condition_variable_any sleep;
+    std::unique_lock lock{mutex};
+    while (true) {
+      sleep.wait_for(lock, stop, m_interval, [] { return false; });
+      if (stop.stop_requested())
+        return;
+      auto current = stamp();
+      if (current == m_stamp || current == file_stamp{})
+        continue;
+      m_stamp = current;
+      try {
+        auto input = input_source::read_file(m_path);
+        m_document.publish(input.view());
+      } catch (...) {
+        if (m_on_error)
+          m_on_error(std::current_exception());
+      }
+    }
+  }
+
+  shared_document &m_document;
+  std::filesystem::path m_path;
+  std::chrono::milliseconds m_interval;
+  error_handler m_on_error;
+  file_stamp m_stamp;
+  std::jthread m_thread; // last, so that it stops before the rest goes
+};
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_SHARED_DOCUMENT_HPP
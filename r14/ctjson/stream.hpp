@@ -0,0 +1,359 @@
+#ifndef GKXX_CTJSON_STREAM_HPP
+#define GKXX_CTJSON_STREAM_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "dom.hpp"
+
+// Incremental parser for input that arrives in chunks. The grammar is run by
+// a coroutine that suspends whenever it needs a character beyond the current
+// chunk, even in the middle of a token, and resumes on the next feed(). Events
+// are emitted as soon as they are complete. Apart from the token being read,
+// the parser only keeps one byte per open container, so duplicate object keys
+// are not detected.
+
+namespace gkxx::ctjson::stream {
+
+using dom::parse_error;
+
+enum class EventKind : unsigned char {
+  BeginObject,
+  EndObject,
+  BeginArray,
+  EndArray,
+  Key,
+  Integer,
+  String,
+  True,
+  False,
+  Null
+};
+
+/// @brief A grammar event. `text` is the unescaped key or string and is only
+/// valid during the call to the handler.
+struct Event {
+  EventKind kind;
+  int integer = 0;
+  std::string_view text{};
+};
+
+namespace detail {
+
+  struct task {
+    struct promise_type {
+      std::exception_ptr exception;
+
+      task get_return_object() noexcept {
+        return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_always initial_suspend() noexcept {
+        return {};
+      }
+      std::suspend_always final_suspend() noexcept {
+        return {};
+      }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept {
+        exception = std::current_exception();
+      }
+    };
+
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept
+        : handle{handle} {}
+    task(task &&other) noexcept : handle{std::exchange(other.handle, {})} {}
+    task(const task &) = delete;
+    ~task() {
+      if (handle)
+        handle.destroy();
+    }
+
+    std::coroutine_handle<promise_type> handle;
+  };
+
+} // namespace detail
+
+/// @brief Calls handler(const Event &) for every event of the document fed to
+/// it chunk by chunk. A chunk is not referred to after feed() returns.
+template <typename Handler>
+class Parser {
+ public:
+  /// @param max_depth As for dom::parse. The parser itself does not recurse,
+  /// but rejects the same nesting depth as dom::parse.
+  explicit Parser(Handler handler,
+                  std::size_t max_depth = dom::default_max_depth)
+      : m_handler(std::move(handler)), m_max_depth{max_depth}, m_task{run()} {}
+  Parser(const Parser &) = delete;
+  Parser &operator=(const Parser &) = delete;
+
+  /// @brief Parses as much of the document as the chunk allows.
+  /// @throws parse_error, with the position counted from the first chunk.
+  /// Once thrown, the same error is thrown again by every later feed() and
+  /// finish().
+  /// @throws std::logic_error after finish().
+  void feed(std::span<const char> chunk) {
+    rethrow_error();
+    if (m_end_of_input)
+      throw std::logic_error("stream::Parser::feed() after finish()");
+    m_chunk = chunk;
+    m_next = 0;
+    resume();
+  }
+
+  /// @brief Signals the end of input.
+  /// @throws parse_error if the document is incomplete.
+  void finish() {
+    m_chunk = {};
+    m_next = 0;
+    m_end_of_input = true;
+    resume();
+  }
+
+  bool done() const noexcept {
+    return m_task.handle.done();
+  }
+
+  /// @brief Number of bytes consumed so far.
+  std::size_t offset() const noexcept {
+    return m_offset;
+  }
+
+ private:
+  static constexpr int end_of_input = -1;
+  static constexpr int no_char = -2;
+
+  struct char_awaiter {
+    Parser *parser;
+    bool await_ready() const noexcept {
+      return parser->m_next < parser->m_chunk.size() ||
+             parser->m_end_of_input;
+    }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    int await_resume() const noexcept {
+      if (parser->m_next == parser->m_chunk.size())
+        return end_of_input;
+      ++parser->m_offset;
+      return static_cast<unsigned char>(parser->m_chunk[parser->m_next++]);
+    }
+  };
+
+  char_awaiter next_char() noexcept {
+    return {this};
+  }
+
+  void resume() {
+    if (!m_task.handle.done())
+      m_task.handle.resume();
+    rethrow_error();
+  }
+
+  // The coroutine ends at its first error, which is kept in the promise.
+  void rethrow_error() const {
+    if (auto exception = m_task.handle.promise().exception)
+      std::rethrow_exception(exception);
+  }
+
+  [[noreturn]] void fail(std::string_view message,
+                         std::size_t position) const {
+    throw parse_error(std::string(message), position);
+  }
+
+  // Offset of the character just read.
+  std::size_t here() const noexcept {
+    return m_offset - 1;
+  }
+
+  void emit(EventKind kind, int integer = 0, std::string_view text = {}) {
+    m_handler(Event{kind, integer, text});
+  }
+
+  enum class State {
+    Value,
+    FirstElement,
+    FirstKey,
+    Key,
+    Colon,
+    AfterValue,
+    Done
+  };
+
+  State after_value() const noexcept {
+    return m_stack.empty() ? State::Done : State::AfterValue;
+  }
+
+  detail::task run() {
+    auto state = State::Value;
+    auto pending = no_char;
+    while (true) {
+      int c = pending;
+      pending = no_char;
+      if (c == no_char)
+        c = co_await next_char();
+      while (c != end_of_input && is_whitespace(static_cast<char>(c)))
+        c = co_await next_char();
+      if (c == end_of_input) {
+        if (state == State::Done)
+          co_return;
+        fail("unexpected end of input", m_offset);
+      }
+
+      auto key = false;
+      switch (state) {
+      case State::Done:
+        fail("expects end of string", here());
+
+      case State::Colon:
+        if (c != ':')
+          fail("expects ':'", here());
+        state = State::Value;
+        continue;
+
+      case State::AfterValue:
+        if (c == ',') {
+          state = m_stack.back() == '{' ? State::Key : State::Value;
+          continue;
+        }
+        if (c != (m_stack.back() == '{' ? '}' : ']'))
+          fail(m_stack.back() == '{' ? "expects '}'" : "expects ']'", here());
+        close();
+        state = after_value();
+        continue;
+
+      case State::FirstKey:
+        if (c == '}') {
+          close();
+          state = after_value();
+          continue;
+        }
+        [[fallthrough]];
+      case State::Key:
+        if (c != '"')
+          fail("expects String", here());
+        key = true;
+        break;
+
+      case State::FirstElement:
+        if (c == ']') {
+          close();
+          state = after_value();
+          continue;
+        }
+        break;
+
+      case State::Value:
+        break;
+      }
+
+      // A key or a value starting with c
+      auto start = here();
+      switch (c) {
+      case '{':
+        open('{', start);
+        emit(EventKind::BeginObject);
+        state = State::FirstKey;
+        continue;
+
+      case '[':
+        open('[', start);
+        emit(EventKind::BeginArray);
+        state = State::FirstElement;
+        continue;
+
+      default: {
+        if (c == '}' || c == ']' || c == ',' || c == ':')
+          fail("expects Value", start);
+        // The lexer DFA is stepped as the characters of the token arrive,
+        // and the token collected in m_token is then read with lex::scan.
+        m_token.clear();
+        auto s = lex::state::Start;
+        while (true) {
+          s = lex::next_state(s, c == end_of_input
+                                     ? lex::char_class::EndOfInput
+                                     : lex::classify(static_cast<char>(c)));
+          if (s == lex::state::AcceptBefore) {
+            pending = c;
+            break;
+          }
+          if (c != end_of_input)
+            m_token += static_cast<char>(c);
+          if (lex::is_final(s))
+            break;
+          c = co_await next_char();
+        }
+        auto lexeme = lex::scan(m_token, 0);
+        switch (lexeme.kind) {
+        case lex::token_kind::String: {
+          std::string_view text = m_token;
+          if (lexeme.escapes == 0)
+            text = text.substr(1, text.size() - 2);
+          else {
+            m_text.clear();
+            lex::append_contents(m_token, 0, m_token.size(), m_text);
+            text = m_text;
+          }
+          if (key) {
+            emit(EventKind::Key, 0, text);
+            state = State::Colon;
+            continue;
+          }
+          emit(EventKind::String, 0, text);
+          break;
+        }
+        case lex::token_kind::Integer: {
+          auto checked = lex::check_integer(m_token, 0, m_token.size());
+          if (!checked.error.empty())
+            fail(checked.error, start + checked.error_position);
+          emit(EventKind::Integer, checked.value);
+          break;
+        }
+        case lex::token_kind::True:
+          emit(EventKind::True);
+          break;
+        case lex::token_kind::False:
+          emit(EventKind::False);
+          break;
+        case lex::token_kind::Null:
+          emit(EventKind::Null);
+          break;
+        default:
+          fail(lexeme.error, start + lexeme.error_position);
+        }
+      }
+      }
+      state = after_value();
+    }
+  }
+
+  void open(char bracket, std::size_t position) {
+    if (m_stack.size() == m_max_depth)
+      fail("too deep", position);
+    m_stack.push_back(bracket);
+  }
+
+  void close() {
+    emit(m_stack.back() == '{' ? EventKind::EndObject : EventKind::EndArray);
+    m_stack.pop_back();
+  }
+
+  Handler m_handler;
+  std::size_t m_max_depth;
+  std::span<const char> m_chunk;
+  std::size_t m_next = 0;
+  std::size_t m_offset = 0;
+  bool m_end_of_input = false;
+  std::vector<char> m_stack;
+  std::string m_token;
+  std::string m_text; // m_token unescaped
+  detail::task m_task;
+};
+
+} // namespace gkxx::ctjson::stream
+
+#endif // GKXX_CTJSON_STREAM_HPP
@@ -1,7 +1,39 @@
+#include "batch.hpp"
+#include "columnar.hpp"
 #include "ctjson.hpp"
+#include "fold.hpp"
+#include "incremental.hpp"
+#include "input.hpp"
+#include "lexer.hpp"
+#include "merge_patch.hpp"
+#include "ndjson.hpp"
+#include "ondemand.hpp"
+#include "parallel_parse.hpp"
+#include "query.hpp"
+#include "schema.hpp"
+#include "serialize.hpp"
+#include "shared_document.hpp"
+#include "stream.hpp"
+#include "type_id.hpp"
 #include "type_name.hpp"
+#include "visit.hpp"
+#include "writer.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 constexpr const char cppconfig[] = R"(
   {
@@ -25,6 +57,24 @@ constexpr const char cppconfig[] = R"(
 }
 )";
 
+constexpr const char cppconfig_schema[] = R"(
+{
+  "type": "object",
+  "required": ["configuration", "version"],
+  "properties": {
+    "configuration": {
+      "type": "object",
+      "required": ["name", "compilerPath"],
+      "properties": {
+        "cStandard": {"enum": ["c11", "c17", "c23"]},
+        "compilerArgs": {"type": "array", "items": {"type": "string"}}
+      }
+    },
+    "version": {"type": "integer", "minimum": 1, "maximum": 4}
+  }
+}
+)";
+
 constexpr const char tasks[] = R"(
   {
     "tasks": [
@@ -57,6 +107,58 @@ constexpr const char tasks[] = R"(
 }
 )";
 
+// A document of task records generated into a byte array, the way a build
+// step would turn a large JSON file into one for parse_bytes.
+struct task_records {
+  static constexpr std::string_view record =
+      R"({"label": "task ????", "priority": ?, "args": ["-O2", "-g", "-Wall"], )"
+      R"("isDefault": false, "detail": null})";
+  static constexpr int count = 500;
+  char bytes[count * (record.size() + 2)];
+};
+
+constexpr task_records make_task_records() {
+  task_records result{};
+  auto out = result.bytes;
+  *out++ = '[';
+  for (int i = 0; i != task_records::count; ++i) {
+    if (i != 0) {
+      *out++ = ',';
+      *out++ = '\n';
+    }
+    int digits[] = {i / 1000, i / 100 % 10, i / 10 % 10, i % 10, i % 7};
+    auto next_digit = digits;
+    for (auto c : task_records::record)
+      *out++ = c == '?' ? static_cast<char>('0' + *next_digit++) : c;
+  }
+  *out = ']';
+  return result;
+}
+
+constexpr auto large_tasks = make_task_records();
+
+// What the parse_error thrown by f says, or "" if it throws none.
+template <typename F>
+std::string parse_error_of(F f) {
+  try {
+    f();
+  } catch (const gkxx::ctjson::dom::parse_error &e) {
+    return e.what();
+  }
+  return {};
+}
+
+struct Task {
+  std::string label;
+  std::vector<std::string> args;
+  bool is_default;
+};
+
+struct Command {
+  std::string label;
+  std::vector<std::string> args;
+};
+
 int main() {
   using namespace gkxx::ctjson;
 
@@ -68,9 +170,800 @@ int main() {
 
   using cppconfig_result = parse<cppconfig>::result;
   std::cout << gkxx::get_type_name<cppconfig_result>() << std::endl;
+  static_assert(gkxx::type_name_v<cppconfig_result>.to_string_view() ==
+                gkxx::get_type_name<cppconfig_result>());
   std::cout << pretty_type_name<cppconfig_result>() << std::endl;
+  static_assert(std::is_same_v<parse_bytes<cppconfig>::result, cppconfig_result>);
+  using large_tasks_result = parse_bytes<large_tasks.bytes>::result;
+  static_assert(sizeof(large_tasks.bytes) > 50'000);
+  static_assert(std::is_same_v<large_tasks_result::get<499>::get<"label">,
+                               String<"task 0499">>);
+  static_assert(std::is_same_v<large_tasks_result::get<499>::get<"priority">,
+                               Integer<499 % 7>>);
+
+  using schema = parse<cppconfig_schema>::result;
+  static_assert(matches_schema<schema, cppconfig_result>);
+  assert(schema_validator<schema>{}(dom::from_node<cppconfig_result>()));
+  using unknown_standard =
+      overlay<cppconfig_result,
+              parse<R"({"configuration": {"cStandard": "c99"}})">::result>::result;
+  static_assert(!matches_schema<schema, unknown_standard>);
+  assert(!schema_validator<schema>{}(dom::from_node<unknown_standard>()));
+
+  // enum compares Objects regardless of member order, at compile time as at
+  // run time.
+  using point_schema =
+      parse<R"({"enum": [{"x": 1, "y": [2, {"a": 1, "b": 2}]}]})">::result;
+  using swapped_point = parse<R"({"y": [2, {"b": 2, "a": 1}], "x": 1})">::result;
+  static_assert(matches_schema<point_schema, swapped_point>);
+  assert(schema_validator<point_schema>{}(dom::from_node<swapped_point>()));
+  using partial_point = parse<R"({"x": 1, "y": [2, {"a": 1}]})">::result;
+  static_assert(!matches_schema<point_schema, partial_point>);
+  assert(!schema_validator<point_schema>{}(dom::from_node<partial_point>()));
+  using other_point = parse<R"({"x": 1, "z": [2, {"a": 1, "b": 2}]})">::result;
+  static_assert(!matches_schema<point_schema, other_point>);
+  assert(!schema_validator<point_schema>{}(dom::from_node<other_point>()));
+
+  for_each_member<cppconfig_result::get<"configuration">>(
+      [](auto key, auto value) {
+        std::cout << key.to_string_view() << ": " << value.to_string()
+                  << std::endl;
+      });
+
+  using site_config = overlay<
+      cppconfig_result,
+      parse<R"({"configuration": {"compilerPath": "/usr/bin/clang++-17"}})">::result,
+      parse<R"({"configuration": {"cStandard": null}, "version": 5})">::result>::result;
+  std::cout << pretty_type_name<site_config>() << std::endl;
+  using site_configuration = site_config::get<"configuration">;
+  static_assert(std::is_same_v<site_configuration::get<"compilerPath">,
+                               String<"/usr/bin/clang++-17">>);
+  static_assert(!site_configuration::contains<"cStandard">);
+  static_assert(std::is_same_v<site_configuration::get<"cppStandard">,
+                               String<"c++20">>);
+  static_assert(std::is_same_v<site_config::get<"version">, Integer<5>>);
+  // version 5 is above the schema's maximum of 4.
+  static_assert(!matches_schema<schema, site_config>);
+  assert(!schema_validator<schema>{}(dom::from_node<site_config>()));
+  static_assert(!overlay<parse<"{}">::result,
+                         parse<R"({"a": null})">::result>::result::contains<"a">);
+  static_assert(std::is_same_v<
+                overlay<parse<"{}">::result,
+                        parse<R"({"a": {"b": null, "c": 1}})">::result>::result,
+                parse<R"({"a": {"c": 1}})">::result>);
 
   using tasks_result = parse<tasks>::result;
   std::cout << pretty_type_name<tasks_result>() << std::endl;
+
+  static_assert([] {
+    std::size_t strings = 0;
+    visit<tasks_result>([&](auto node) {
+      strings += detect::is_string_token<decltype(node)>;
+    });
+    return strings;
+  }() == 14);
+
+  struct count_strings {
+    constexpr int operator()(int n, const events::string &) const {
+      return n + 1;
+    }
+  };
+  static_assert(fold<tasks, count_strings, 0>::value == 14);
+  // The same errors as parse<>, whose lexer it shares.
+  using unfinished_escape = fold<R"("a\)", count_strings, 0>;
+  static_assert(!unfinished_escape::ok);
+  static_assert(unfinished_escape::error_message == "unsupported escape");
+  static_assert(unfinished_escape::error_position == 3);
+  static_assert(std::is_same_v<parse<R"("a\)">::result,
+                               ErrorToken<"unsupported escape", 3>>);
+  using trailing_letter = fold<"truex", count_strings, 0>;
+  static_assert(trailing_letter::error_message == "Unrecognized token");
+  static_assert(trailing_letter::error_position == 4);
+  static_assert(std::is_same_v<parse<"truex">::result,
+                               ErrorToken<"Unrecognized token", 4>>);
+  static_assert(fold<R"(["a", 01])", count_strings, 0>::error_message ==
+                "too many leading zeros");
+  // Events follow the nesting, and syntax errors are at an offset in Src.
+  struct shape {
+    int depth = 0, max_depth = 0, keys = 0;
+  };
+  struct measure_shape {
+    constexpr shape operator()(shape s, events::begin_object) const {
+      return {s.depth + 1, std::max(s.max_depth, s.depth + 1), s.keys};
+    }
+    constexpr shape operator()(shape s, events::begin_array) const {
+      return (*this)(s, events::begin_object{});
+    }
+    constexpr shape operator()(shape s, events::end_object) const {
+      return {s.depth - 1, s.max_depth, s.keys};
+    }
+    constexpr shape operator()(shape s, events::end_array) const {
+      return (*this)(s, events::end_object{});
+    }
+    constexpr shape operator()(shape s, const events::key &) const {
+      return {s.depth, s.max_depth, s.keys + 1};
+    }
+  };
+  using nested = fold<R"({"a": [1, {"b": []}], "c": {}})", measure_shape,
+                      shape{}>;
+  static_assert(nested::ok && nested::value.depth == 0 &&
+                nested::value.max_depth == 4 && nested::value.keys == 3);
+  using duplicate = fold<R"({"a": 1, "a": 2})", count_strings, 0>;
+  static_assert(duplicate::error_message == "duplicate object key" &&
+                duplicate::error_position == 9);
+  static_assert(std::is_same_v<parse<R"({"a": 1, "a": 2})">::result,
+                               SyntaxError<"duplicate object key", 5>>);
+  using unclosed = fold<"[1 2]", count_strings, 0>;
+  static_assert(unclosed::error_message == "expects ']'" &&
+                unclosed::error_position == 3);
+
+  static_assert(gkxx::type_id_v<cppconfig_result> !=
+                gkxx::type_id_v<tasks_result>);
+  static_assert(gkxx::type_id_v<True> != gkxx::type_id_v<False>);
+  using registry = gkxx::type_registry<cppconfig_result, tasks_result>;
+  static_assert(registry::contains_id(gkxx::type_id_v<tasks_result>) &&
+                !registry::contains_id(gkxx::type_id_v<True>));
+  int visits = 0;
+  bool dispatched = registry::dispatch(
+      gkxx::type_id_v<tasks_result>, [&visits](auto type) {
+        visits += std::is_same_v<typename decltype(type)::type, tasks_result>;
+      });
+  assert(dispatched && visits == 1);
+  dispatched = registry::dispatch(gkxx::type_id_v<True>,
+                                  [&visits](auto) { ++visits; });
+  assert(!dispatched && visits == 1);
+
+  static_assert(std::is_same_v<Tokenizer<"[1, \"a\"]">::result,
+                               TokenSequence<LBracket, Integer<1>, Comma,
+                                             String<"a">, RBracket>>);
+  static_assert(std::is_same_v<Tokenizer<"[tru]">::result,
+                               ErrorToken<"expects 'true'", 1>>);
+
+  // ParseTokens gives what parse<> gives on the source of the tokens.
+  static_assert(std::is_same_v<
+                ParseTokens<Tokenizer<cppconfig>::result>::result,
+                cppconfig_result>);
+  using escaped_tokens =
+      Tokenizer<R"(["a\"\\\n\u0001", -2147483648])">::result;
+  static_assert(std::is_same_v<escaped_tokens::nth<2>::type, Comma>);
+  static_assert(std::is_same_v<ParseTokens<escaped_tokens>::result,
+                               Array<String<"a\"\\\n\x01">,
+                                     Integer<-2147483648>>>);
+  static_assert(std::is_same_v<
+                ParseTokens<Tokenizer<R"({"a": 1, "a": 2})">::result>::result,
+                SyntaxError<"duplicate object key", 5>>);
+
+  // ParseTokens reads the token types themselves, so it takes sequences that
+  // no source tokenizes to.
+  static_assert(std::is_same_v<
+                ParseTokens<TokenSequence<KeywordToken<"foo">>>::result,
+                KeywordToken<"foo">>);
+  static_assert(std::is_same_v<
+                ParseTokens<TokenSequence<LBracket, KeywordToken<"foo">,
+                                          RBracket>>::result,
+                Array<KeywordToken<"foo">>>);
+  static_assert(std::is_same_v<ParseTokens<TokenSequence<>>::result,
+                               SyntaxError<"expects Value", 0>>);
+  static_assert(std::is_same_v<
+                ParseTokens<TokenSequence<LBracket, Integer<1>>>::result,
+                SyntaxError<"expects ']'", 2>>);
+  static_assert(std::is_same_v<
+                ParseTokens<TokenSequence<LBracket, PunctToken<'x'>>>::result,
+                SyntaxError<"expects Value", 1>>);
+  static_assert(std::is_same_v<
+                ParseTokens<TokenSequence<
+                    LBrace, String<"a">, Colon,
+                    ErrorToken<"expects 'true'", 6>, RBrace>>::result,
+                SyntaxError<"expects Value", 3>>);
+  static_assert(std::is_same_v<
+                ParseTokens<TokenSequence<LBrace, String<"a">, Colon, Null,
+                                          Comma, String<"a">, Colon,
+                                          True, RBrace>>::result,
+                SyntaxError<"duplicate object key", 5>>);
+
+  // One token at a time, as before the Tokenizer read them in one loop.
+  using spaced = Tokenizer<R"(  {"k\n": -12 , "v": nul })">;
+  static_assert(spaced::next_nonwhitespace_pos<0>::result == 2);
+  static_assert(spaced::next_nonwhitespace_pos<2>::result == 2);
+  using key_token = spaced::token_getter<3>::result;
+  static_assert(std::is_same_v<key_token::token, String<"k\n">> &&
+                key_token::end_pos == 8);
+  using number_token = spaced::token_getter<10>::result;
+  static_assert(std::is_same_v<number_token::token, Integer<-12>> &&
+                number_token::end_pos == 13);
+  static_assert(std::is_same_v<spaced::token_getter<21>::result::token,
+                               ErrorToken<"expects 'null'", 21>>);
+  static_assert(std::is_same_v<spaced::result,
+                               ErrorToken<"expects 'null'", 21>>);
+  static_assert(std::is_same_v<
+                gkxx::meta::switch_<spaced::token_getter<2>::result::end_pos,
+                                    gkxx::meta::case_<3, LBrace>,
+                                    gkxx::meta::default_<RBrace>>::type,
+                LBrace>);
+
+  // The runtime lexer reads the same tokens as the Tokenizer.
+  using cppconfig_tokens = detail::token_table<gkxx::fixed_string(cppconfig)>;
+  std::size_t token_count = 0;
+  for (dom::scalar_lexer lexer(cppconfig); auto token = lexer.next();) {
+    const auto &expected = cppconfig_tokens::tokens[token_count++];
+    assert(token->kind == expected.kind);
+    assert(token->position == expected.begin);
+    assert(token->text.size() == expected.end - expected.begin);
+    assert(token->value == expected.value);
+  }
+  assert(token_count == cppconfig_tokens::size);
+  {
+    dom::scalar_lexer lexer(R"({"version": 4})");
+    assert(lexer.next()->kind == dom::token_kind::Punct);
+    assert(lexer.next()->text == R"("version")");
+    assert(lexer.next()->text == ":");
+    auto version = lexer.next();
+    assert(version->kind == dom::token_kind::Integer && version->value == 4);
+    assert(lexer.next()->text == "}");
+    assert(!lexer.next());
+  }
+  assert(parse_error_of([] {
+           dom::scalar_lexer lexer("[1, 2, tru]");
+           while (lexer.next())
+             ;
+         }) == "expects 'true' at index 7");
+
+  {
+    // Events do not depend on where the chunks end.
+    std::string_view document = R"({"a": [12, "x\ty"], "b": true})";
+    auto events_of = [&](std::size_t chunk_size) {
+      std::string events;
+      stream::Parser parser([&](const stream::Event &event) {
+        events += std::to_string(static_cast<int>(event.kind));
+        if (event.kind == stream::EventKind::Integer)
+          events += '=' + std::to_string(event.integer);
+        events += std::string(event.text) + ' ';
+      });
+      for (std::size_t i = 0; i < document.size(); i += chunk_size)
+        parser.feed(document.substr(i, chunk_size));
+      parser.finish();
+      assert(parser.done());
+      return events;
+    };
+    assert(events_of(document.size()) == "0 4a 2 5=12 6x\ty 3 4b 7 1 ");
+    assert(events_of(1) == events_of(document.size()));
+
+    stream::Parser parser([](const stream::Event &) {});
+    auto feed = [&](std::string_view chunk) {
+      return parse_error_of([&] { parser.feed(chunk); });
+    };
+    assert(feed("[1, 2").empty());
+    assert(feed(" 3]") == "expects ']' at index 6");
+    // The error stays.
+    assert(feed("]") == "expects ']' at index 6");
+    assert(parse_error_of([&] { parser.finish(); }) ==
+           "expects ']' at index 6");
+
+    stream::Parser unfinished([](const stream::Event &) {});
+    unfinished.feed(std::string_view{"[1"});
+    assert(parse_error_of([&] { unfinished.finish(); }) ==
+           "unexpected end of input at index 2");
+
+    stream::Parser finished([](const stream::Event &) {});
+    finished.feed(std::string_view{"1"});
+    finished.finish();
+    auto fed_after_finish = false;
+    try {
+      finished.feed(std::string_view{" "});
+    } catch (const std::logic_error &) {
+      fed_after_finish = true;
+    }
+    assert(fed_after_finish);
+  }
+
+  {
+    // Each edit leaves the same DOM as parsing the edited text from scratch.
+    dom::incremental_document document{std::string(tasks)};
+    std::string text = tasks;
+    auto edit = [&](std::string_view from, std::string_view to) {
+      text.replace(text.find(from), from.size(), to);
+      auto parsed = document.update(text);
+      assert(document.text() == text);
+      assert(dom::to_string(document.root()) ==
+             dom::to_string(dom::parse(text)));
+      return parsed;
+    };
+    // Edits inside a container only parse a few of its children again.
+    auto local = [&](std::size_t parsed) { return parsed < text.size() / 8; };
+    assert(local(edit(R"("-g")", R"("-O2", "-g")")));
+    assert(local(edit(R"("cwd")", R"("workdir")")));
+    assert(local(edit(R"("isDefault": true)", R"("isDefault": false)")));
+    assert(local(edit(R"("-o",)", "")));
+    assert(local(edit(R"("$gcc"
+            ])",
+                      R"("$gcc", "$msCompile"])")));
+    assert(local(edit(R"("$gcc")", R"("$gcc", {"x": [1, 2]})")));
+    assert(local(edit(R"("version": "2.0.0")", R"("version": "2.1.0")")));
+    assert(document.root().find("version")->as_string() == "2.1.0");
+    // Without a container around it, the edit is parsed as a whole.
+    text = '[' + text + ']';
+    assert(document.update(text) == text.size());
+    assert(dom::to_string(document.root()) ==
+           dom::to_string(dom::parse(text)));
+    assert(document.update(text) == 0);
+    auto before = dom::to_string(document.root());
+    assert(parse_error_of([&] {
+             document.update(text + "]");
+           }).starts_with("expects end of string"));
+    assert(document.text() == text);
+    assert(dom::to_string(document.root()) == before);
+  }
+
+  {
+    // 100 rows, so that the kernels go through a full bitmap word and a
+    // partial one. Row i has "n": i, except that the rows ending in 9 have a
+    // string there, and "ok" is missing from the odd rows.
+    std::string rows = "[";
+    for (int i = 0; i != 100; ++i) {
+      rows += i == 0 ? "" : ",";
+      rows += R"({"name": "row)" + std::to_string(i) + R"(", "n": )" +
+              (i % 10 == 9 ? R"("nine")" : std::to_string(i));
+      rows += i % 2 == 0 ? R"(, "ok": true})" : "}";
+    }
+    rows += R"(, 7, {"late": 1}])";
+    auto document = dom::parse(rows);
+    auto table = columnar::from_array(document.as_array());
+    assert(table.rows() == 102 && table.column_count() == 4);
+    assert(table.name(0) == "name" && table.name(3) == "late");
+    const auto &names = table.get<columnar::string_column>("name");
+    const auto &n = table.get<columnar::integer_column>("n");
+    const auto &ok = table.get<columnar::boolean_column>("ok");
+    const auto &late = table.get<columnar::integer_column>("late");
+    assert(names.size() == 102 && names[42] == "row42" && names[100].empty());
+    assert(names.valid.count() == 100 && !names.valid.test(101));
+    assert(n.valid.count() == 90 && !n.valid.test(9) && n.values[9] == 0);
+    assert(ok.valid.count() == 50 && ok.valid.test(98) && !ok.valid.test(99));
+    assert(late.valid.count() == 1 && late.valid.test(101));
+    // 0 + ... + 99 without 9, 19, ..., 99.
+    assert(columnar::sum(n) == 4950 - 540);
+    auto even = columnar::select(ok);
+    assert(even.count() == 50);
+    assert(columnar::sum(n, &even) == 2450);
+    auto big = columnar::select(n, [](int v) { return v > 95; });
+    assert(big.count() == 3 && big.test(98) && !big.test(99));
+    auto named = columnar::select(names, [](std::string_view name) {
+      return name.ends_with('7');
+    });
+    assert(named.count() == 10 && (named & big).count() == 1);
+    // Only the columns of the sample, whatever comes first in the rows.
+    auto sampled = columnar::from_array<
+        parse<R"({"ok": false, "n": 0, "missing": "string"})">::result>(
+        document.as_array());
+    assert(sampled.column_count() == 3 && sampled.name(0) == "ok");
+    assert(!sampled.find("name"));
+    assert(sampled.get<columnar::string_column>("missing").valid.count() ==
+           0);
+  }
+
+  {
+    auto document = dom::parse(tasks);
+    auto labels = query::collect<
+        R"(.tasks[] | select(.type == "cppbuild") | .label)">(document);
+    assert(labels.size() == 1 &&
+           labels[0]->as_string() == "C/C++: g++-12 build active file");
+    assert(query::collect<R"(.tasks[] | select(.type == "shell"))">(document)
+               .empty());
+    auto flags = query::collect<R"(.tasks[0].args[] | select(. >= "-o"))">(
+        document);
+    assert(flags.size() == 2 && flags[0]->as_string() == "-o");
+    assert(query::collect<".tasks[0].args[-1]">(document)[0]->as_string() ==
+           "-std=c++20");
+    // Missing members give null, and steps that do not apply give nothing.
+    assert(query::collect<".tasks[0].missing">(document)[0]->is_null());
+    assert(query::collect<".version[]">(document).empty());
+    static_assert(detect::is_syntax_error<
+                  query::parse<".tasks[] |">::result>);
+    static_assert(std::is_same_v<query::parse<".a | select(.b = 1)">::result,
+                                 ErrorToken<"expects '=='", 15>>);
+    static_assert(std::is_same_v<query::parse<R"(select(.a == "\q"))">::result,
+                                 ErrorToken<"unsupported escape", 15>>);
+    static_assert(std::is_same_v<query::parse<".a[01]">::result,
+                                 ErrorToken<"too many leading zeros", 3>>);
+  }
+
+  {
+    std::vector<std::string_view> messages = {
+        R"({"id": 1, "tags": ["a"]})", R"({"id": 2, "tags": []})", "[1, 2]",
+        R"("text")", R"({"id": 3, "tags": ["b", "c"]})"};
+    auto batch = dom::parse_batch(messages);
+    assert(batch.size() == messages.size());
+    for (std::size_t i = 0; i != messages.size(); ++i)
+      assert(dom::to_string(batch[i]) ==
+             dom::to_string(dom::parse(messages[i])));
+    // One parser reads the whole batch, so the objects share their shape.
+    assert(batch[0].as_object().same_shape(batch[4].as_object()));
+    dom::batch moved(0);
+    moved = std::move(batch);
+    assert(moved[4].find("tags")->as_array()[1].as_string() == "c");
+
+    messages[3] = R"({"id": 4, "id": 5})";
+    auto failed = false;
+    try {
+      dom::parse_batch(messages);
+    } catch (const dom::batch_parse_error &e) {
+      failed = true;
+      assert(e.index() == 3 && e.position() == 10);
+      assert(e.message() == "duplicate object key in message 3");
+    }
+    assert(failed);
+  }
+
+  {
+    // Chunks that start inside strings, right after a backslash or among
+    // escaped quotes and brackets still meet at the right delimiters.
+    std::string_view src = R"([ "a\"]", {"b": ["\\", "}\"{"]}, [[]], -7,
+      "\\\"[,", {}, "x,]\\", [1, {"c": "]"}], true ])";
+    auto expected = dom::to_string(dom::parse(src));
+    gkxx::work_stealing_pool pool(3);
+    for (std::size_t chunk_size = 1; chunk_size < src.size(); ++chunk_size) {
+      dom::ParallelStats stats;
+      auto value = dom::parse_parallel(
+          src, pool, std::pmr::new_delete_resource(), {chunk_size}, &stats);
+      assert(dom::to_string(value) == expected);
+      assert(stats.parallel);
+      assert(stats.chunks == (src.size() + chunk_size - 1) / chunk_size);
+    }
+    // Too small to split, not an array, or invalid: dom::parse does it all.
+    dom::ParallelStats stats;
+    dom::parse_parallel(src, pool, std::pmr::new_delete_resource(),
+                        {src.size()}, &stats);
+    assert(!stats.parallel);
+    dom::parse_parallel(R"({"a": [1, 2, 3]})", pool,
+                        std::pmr::new_delete_resource(), {4}, &stats);
+    assert(!stats.parallel);
+    std::string_view invalid = R"([1, "a\"", {"b" 2}, 3])";
+    assert(parse_error_of([&] {
+             dom::parse_parallel(invalid, pool, std::pmr::new_delete_resource(),
+                                 {4}, &stats);
+           }) == parse_error_of([&] { dom::parse(invalid); }));
+    assert(!stats.parallel && stats.chunks != 0);
+  }
+
+  {
+    // CRLF, blank lines and a last line without '\n', cut at every size.
+    std::string_view input =
+        "{\"id\": 1}\r\n\n  \r\n[2, \"a\\nb\"]\n\"three\"";
+    std::vector<std::string> expected = {
+        dom::to_string(dom::parse(R"({"id": 1})")),
+        dom::to_string(dom::parse(R"([2, "a\nb"])")), R"("three")"};
+    gkxx::work_stealing_pool pool(3);
+    for (std::size_t chunk_size = 1; chunk_size <= input.size(); ++chunk_size) {
+      std::vector<std::string> records;
+      auto count = ndjson::for_each_record(
+          input, pool,
+          [&](const dom::Value &record) {
+            records.push_back(dom::to_string(record));
+          },
+          {.chunk_size = chunk_size, .lookahead = 1});
+      assert(count == 3 && records == expected);
+
+      std::mutex mutex;
+      records.clear();
+      count = ndjson::for_each_record(
+          input, pool,
+          [&](const dom::Value &record) {
+            std::lock_guard lock{mutex};
+            records.push_back(dom::to_string(record));
+          },
+          {.chunk_size = chunk_size, .order = ndjson::Order::Unordered});
+      std::sort(records.begin(), records.end());
+      auto sorted = expected;
+      std::sort(sorted.begin(), sorted.end());
+      assert(count == 3 && records == sorted);
+    }
+
+    // The first malformed line is reported, in either order, with its record
+    // index and its position in the input.
+    std::string_view malformed = "1\n\n{\"a\": }\r\n[";
+    for (auto order : {ndjson::Order::Preserved, ndjson::Order::Unordered})
+      for (std::size_t chunk_size : {std::size_t{1}, std::size_t{64}}) {
+        auto failed = false;
+        try {
+          ndjson::for_each_record(
+              malformed, pool, [](const dom::Value &) {},
+              {.chunk_size = chunk_size, .order = order});
+        } catch (const ndjson::record_error &e) {
+          failed = true;
+          assert(e.index() == 1 && e.position() == 9);
+          assert(e.message() == "expects Value in record 1");
+        }
+        assert(failed);
+      }
+  }
+
+  {
+    // Destroying the pool runs the work still queued before the workers
+    // stop.
+    std::atomic<int> done = 0;
+    {
+      gkxx::work_stealing_pool pool(2);
+      for (int i = 0; i != 100; ++i)
+        pool.submit([&](std::size_t worker) {
+          assert(worker < 2);
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+          ++done;
+        });
+    }
+    assert(done == 100);
+    gkxx::work_stealing_pool pool(4);
+    for (int i = 0; i != 100; ++i)
+      pool.submit([&](std::size_t) { ++done; });
+    pool.wait();
+    assert(done == 200);
+  }
+
+  dom::Value task;
+  {
+    std::pmr::monotonic_buffer_resource arena;
+    auto document = dom::parse(tasks, &arena);
+    task = document.find("tasks")->as_array()[0];
+  }
+  assert(task.find("options")->find("cwd")->as_string() == "${fileDirname}");
+  assert(task.find("group")->find("isDefault")->as_bool());
+
+  {
+    // One key table per document, and one shape per sequence of keys.
+    auto rows = dom::parse(R"([{"id": 1, "name": "a"}, {"id": 2, "name": "b"},
+                               {"name": "c", "id": 3},
+                               {"id": 4, "name": "d", "tags": {"id": 5}}])");
+    const auto &array = rows.as_array();
+    const auto &first = array[0].as_object();
+    auto keys = first.keys();
+    assert(first.same_shape(array[1].as_object()));
+    assert(!first.same_shape(array[2].as_object()));
+    for (const auto &row : array)
+      assert(row.as_object().keys() == keys);
+    assert(array[3].find("tags")->as_object().keys() == keys);
+    assert(keys->size() == 3 && keys->shape_count() == 4);
+    auto id = keys->find("id");
+    assert(id && keys->name(*id) == "id" && !keys->find("missing"));
+    for (int i = 0; i != 4; ++i)
+      assert(array[i].as_object().find(*id)->as_integer() == i + 1);
+    assert(!first.find(*keys->find("tags")));
+  }
+
+  assert(parse_error_of([] { dom::parse(std::string(2'000'000, '[')); }) ==
+         "too deep at index 512");
+  assert(parse_error_of([] {
+           dom::parse(std::string(512, '[') + std::string(512, ']'));
+         }).empty());
+  assert(parse_error_of([] {
+           dom::parse("[[1]]", std::pmr::get_default_resource(), 1);
+         }) == "too deep at index 1");
+
+  ondemand::Document doc(tasks);
+  for (auto task : doc.root().get_object()["tasks"].get_array())
+    std::cout << task.get_object()["label"].get_string() << std::endl;
+  {
+    ondemand::Document nested(R"([[1, 2], true])");
+    auto array = nested.root().get_array();
+    auto it = array.begin();
+    auto inner = (*it).get_array();
+    assert((*inner.begin()).get_integer() == 1);
+    assert(parse_error_of([&] { (*it).get_integer(); }) ==
+           "value has already been read at index 1");
+    ++it;
+    assert((*it).get_bool());
+  }
+  assert(parse_error_of([] { ondemand::Document("truex").root().get_bool(); }) ==
+         "Unrecognized token at index 4");
+  assert(parse_error_of([] { ondemand::Document("nullx").root().is_null(); }) ==
+         "Unrecognized token at index 4");
+  {
+    ondemand::Document keyword("[false]");
+    assert(!(*keyword.root().get_array().begin()).get_bool());
+  }
+
+  std::string buffer;
+  serialize<parse<R"({"label": "string", "args": ["string"], "isDefault": "boolean"})">::result>(
+      Task{"build", {"-g", "-std=c++20"}, true}, buffer);
+  std::cout << buffer << std::endl;
+
+  using task_list =
+      parse<R"([{"label": "string", "args": ["string"]}])">::result;
+  buffer.clear();
+  serialize<task_list>(std::vector<Command>{{"a\x01", {"\x1f"}}}, buffer);
+  assert(buffer == R"([{"label":"a\u0001","args":["\u001f"]}])");
+  auto serialized = dom::parse(buffer);
+  assert(serialized.as_array()[0].find("label")->as_string() == "a\x01");
+  assert(serialized.as_array()[0].find("args")->as_array()[0].as_string() ==
+         "\x1f");
+
+  // Long enough for the block and word paths of the writer as well.
+  std::string controls(40, '\x01');
+  controls[33] = '\t';
+  auto written = dom::to_string(dom::parse('"' + controls + '"'));
+  assert(written.size() == 2 + 39 * 6 + 2);
+  assert(written.substr(1 + 32 * 6, 14) == R"(\u0001\t\u0001)");
+  // What the writer escapes is read back as it was.
+  auto with_control = dom::parse("[\"a\x01" "b\"]");
+  assert(dom::to_string(with_control) == R"(["a\u0001b"])");
+  assert(dom::parse(dom::to_string(with_control)).as_array()[0].as_string() ==
+         "a\x01" "b");
+  assert(dom::parse(written).as_string() == std::string_view(controls));
+
+  // \uXXXX is read as UTF-8, with surrogate pairs joined and any other
+  // surrogate read as U+FFFD.
+  assert(dom::parse(R"("\u0041\u00e9\u20AC\ud83d\ude00")").as_string() ==
+         "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+  assert(dom::parse(R"("\ud83dx\ude00\ud83d\ud83d\ude00")").as_string() ==
+         "\xef\xbf\xbdx\xef\xbf\xbd\xef\xbf\xbd\xf0\x9f\x98\x80");
+  assert(parse_error_of([] { dom::parse(R"("\u00g0")"); }) ==
+         "unsupported escape at index 5");
+  static_assert(
+      std::is_same_v<parse<R"(["\u0041\ud83d\ude00", "A\ud83d\ude00"])">::result,
+                     Array<String<"A\xf0\x9f\x98\x80">,
+                           String<"A\xf0\x9f\x98\x80">>>);
+  static_assert(std::is_same_v<parse<R"({"\u0061": 1, "a": 2})">::result,
+                               SyntaxError<"duplicate object key", 5>>);
+
+  {
+    auto padded = [](const input_source &input) {
+      for (std::size_t i = 0; i != input_source::padding; ++i)
+        if (input.data()[input.size() + i] != '\0')
+          return false;
+      return true;
+    };
+    auto path = std::filesystem::temp_directory_path() / "ctjson_input.json";
+    auto from_file = [&](std::string_view text) {
+      std::ofstream(path, std::ios::binary) << text;
+      return input_source::from_file(path);
+    };
+    std::string_view document = tasks;
+    // The padding is the tail of the last page, or pages of its own when the
+    // file fills its last page.
+    for (auto size : {document.size(), std::size_t{4096}}) {
+      std::string text(document);
+      text.resize(size, ' ');
+      auto input = from_file(text);
+      assert(input.is_mapped() == GKXX_CTJSON_HAS_MMAP);
+      assert(input.view() == text && padded(input));
+      assert(dom::to_string(dom::parse(input)) ==
+             dom::to_string(dom::parse(document)));
+    }
+    // read_file never maps, so truncating the file leaves the buffer intact.
+    auto owned = input_source::read_file(path);
+    std::ofstream(path, std::ios::binary | std::ios::trunc);
+    assert(!owned.is_mapped() && owned.size() == 4096 && padded(owned));
+    assert(owned.view().substr(0, document.size()) == document);
+    auto empty = from_file("");
+    assert(!empty.is_mapped() && empty.size() == 0 && padded(empty));
+    std::filesystem::remove(path);
+#if GKXX_CTJSON_HAS_MMAP
+    // A pipe cannot be mapped and is read instead.
+    int fds[2];
+    assert(::pipe(fds) == 0);
+    assert(::write(fds[1], document.data(), document.size()) ==
+           static_cast<ssize_t>(document.size()));
+    ::close(fds[1]);
+    auto piped = input_source::from_file("/dev/fd/" + std::to_string(fds[0]));
+    ::close(fds[0]);
+    assert(!piped.is_mapped());
+    assert(piped.view() == document && padded(piped));
+#endif
+    auto copied = input_source::from_string(document);
+    assert(copied.view() == document && padded(copied));
+  }
+
+  {
+    // Counts the blocks the snapshot arenas take from their upstream.
+    struct counting_resource : std::pmr::memory_resource {
+      std::size_t live = 0;
+      void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++live;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+      }
+      void do_deallocate(void *p, std::size_t bytes,
+                         std::size_t alignment) override {
+        --live;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+      }
+      bool do_is_equal(const memory_resource &other) const noexcept override {
+        return this == &other;
+      }
+    } counting;
+    auto previous = std::pmr::set_default_resource(&counting);
+    auto version_of = [](const shared_document::read_guard &guard) {
+      return guard->find("version")->as_integer();
+    };
+    {
+      shared_document document(R"({"version": 1})", 2);
+      auto per_snapshot = counting.live;
+      auto reader = document.make_reader();
+      auto second_reader = document.make_reader();
+      auto too_many = false;
+      try {
+        document.make_reader();
+      } catch (const std::length_error &) {
+        too_many = true;
+      }
+      assert(too_many);
+      {
+        auto guard = reader.acquire();
+        document.publish(R"({"version": 2})");
+        // The snapshot read by `guard` is retired but not freed.
+        assert(document.version() == 2 && guard.snapshot().version() == 1);
+        assert(version_of(guard) == 1);
+        assert(version_of(second_reader.acquire()) == 2);
+        assert(counting.live == 2 * per_snapshot);
+      }
+      // Freed by the next publish, once no reader announces it, along with
+      // the one that publish replaces.
+      document.publish(R"({"version": 3})");
+      assert(counting.live == per_snapshot);
+      assert(version_of(reader.acquire()) == 3);
+      assert(parse_error_of([&] { document.publish("{"); }) ==
+             "expects String at index 1");
+      assert(document.version() == 3);
+
+      // A reader on another thread only ever sees newer versions.
+      std::jthread watcher([&, reader = std::move(reader)] {
+        for (int seen = 3; seen != 100;) {
+          auto guard = reader.acquire();
+          assert(version_of(guard) >= seen);
+          seen = version_of(guard);
+        }
+      });
+      for (int version = 4; version <= 100; ++version)
+        document.publish(R"({"version": )" + std::to_string(version) + "}");
+    }
+    assert(counting.live == 0);
+    std::pmr::set_default_resource(previous);
+  }
+
+  {
+    auto path = std::filesystem::temp_directory_path() / "ctjson_watched.json";
+    // Replaced by a rename, so that the watcher never reads a partial write.
+    auto replace = [&](std::string_view text) {
+      auto next = path;
+      next += ".next";
+      std::ofstream(next, std::ios::binary) << text;
+      std::filesystem::rename(next, path);
+    };
+    auto wait_until = [](auto done) {
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds{10};
+      while (!done() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+      return done();
+    };
+    replace(R"({"version": 1})");
+    shared_document document(R"({"version": 1})");
+    std::mutex errors_mutex;
+    std::vector<std::string> errors;
+    {
+      file_watcher watcher(
+          document, path, std::chrono::milliseconds{10},
+          [&](std::exception_ptr error) {
+            std::lock_guard lock{errors_mutex};
+            try {
+              std::rethrow_exception(error);
+            } catch (const dom::parse_error &e) {
+              errors.push_back(e.what());
+            }
+          });
+      replace(R"({"version": 20})");
+      assert(wait_until([&] { return document.version() == 2; }));
+      auto reader = document.make_reader();
+      assert(reader.acquire()->find("version")->as_integer() == 20);
+
+      replace("{");
+      assert(wait_until([&] {
+        std::lock_guard lock{errors_mutex};
+        return !errors.empty();
+      }));
+      // The document that failed to parse is not published.
+      assert(document.version() == 2);
+      assert(reader.acquire()->find("version")->as_integer() == 20);
+      std::lock_guard lock{errors_mutex};
+      assert(errors.size() == 1 && errors[0] == "expects String at index 1");
+    }
+    std::filesystem::remove(path);
+  }
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+// The instrumented runtime parser. test.cpp builds the parser with its hooks
+// compiled out, so this file is a program of its own: every TU of a program
+// must agree on GKXX_CTJSON_INSTRUMENT.
+#define GKXX_CTJSON_INSTRUMENT 1
+
+#include "dom.hpp"
+#include "instrument.hpp"
+#include "parallel_parse.hpp"
+#include "thread_pool.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+int main() {
+  using namespace gkxx::ctjson;
+  using dom::Kind;
+  using namespace dom::instrument;
+
+  auto nodes_of = [](const parse_stats &stats, Kind kind) {
+    return stats.nodes[static_cast<std::size_t>(kind)];
+  };
+
+  aggregate totals;
+  auto previous = set_sink(&totals);
+
+  {
+    counting_resource counting{std::pmr::new_delete_resource()};
+    std::string src = R"({"a": [1, "xy", true, {"b\n": null}], "c": false})";
+    auto before = counting.allocated();
+    auto document = dom::parse(src, &counting);
+    auto [parses, stats] = totals.snapshot();
+    assert(parses == 1);
+    assert(stats.bytes == src.size());
+    assert(nodes_of(stats, Kind::Object) == 2);
+    assert(nodes_of(stats, Kind::Array) == 1);
+    assert(nodes_of(stats, Kind::Integer) == 1);
+    assert(nodes_of(stats, Kind::String) == 1);
+    assert(nodes_of(stats, Kind::True) == 1);
+    assert(nodes_of(stats, Kind::False) == 1);
+    assert(nodes_of(stats, Kind::Null) == 1);
+    assert(stats.node_count() == 8);
+    assert(stats.max_depth == 3);
+    // "a", "xy", the unescaped "b\n" and "c".
+    assert(stats.string_bytes == 6);
+    assert(stats.arena_bytes > 0 &&
+           stats.arena_bytes == counting.allocated() - before);
+
+    // Not a counting_resource: no arena bytes.
+    totals.reset();
+    dom::parse("7");
+    auto scalar = totals.snapshot();
+    assert(scalar.parses == 1 && scalar.stats.node_count() == 1);
+    assert(scalar.stats.max_depth == 0 && scalar.stats.arena_bytes == 0);
+  }
+
+  {
+    // Failed parses report nothing.
+    totals.reset();
+    for (auto invalid : {R"({"a": [1, 2})", "[1] 2", R"(["\x"])"}) {
+      bool failed = false;
+      try {
+        dom::parse(invalid);
+      } catch (const dom::parse_error &) {
+        failed = true;
+      }
+      assert(failed);
+    }
+    assert(totals.snapshot().parses == 0);
+  }
+
+  {
+    // parse_parallel reports once, with what dom::parse counts on the same
+    // document.
+    std::string src = "[";
+    for (int i = 0; i != 200; ++i)
+      src += (i ? ", " : "") + std::string(R"({"id": )") + std::to_string(i) +
+             R"(, "tags": ["x", null]})";
+    src += "]";
+
+    totals.reset();
+    dom::parse(src);
+    auto sequential = totals.snapshot().stats;
+
+    counting_resource counting{std::pmr::new_delete_resource()};
+    gkxx::work_stealing_pool pool(4);
+    dom::ParallelStats parallel;
+    totals.reset();
+    auto before = counting.allocated();
+    auto document =
+        dom::parse_parallel(src, pool, &counting, {.chunk_size = 256}, &parallel);
+    auto [parses, stats] = totals.snapshot();
+    assert(parallel.parallel && parallel.chunks > 1);
+    assert(parses == 1);
+    assert(stats.bytes == src.size());
+    assert(stats.nodes == sequential.nodes);
+    assert(nodes_of(stats, Kind::Object) == 200);
+    assert(nodes_of(stats, Kind::Array) == 201);
+    assert(stats.max_depth == 3 && stats.max_depth == sequential.max_depth);
+    assert(stats.string_bytes == sequential.string_bytes);
+    assert(stats.arena_bytes > 0 &&
+           stats.arena_bytes == counting.allocated() - before);
+
+    // A malformed chunk sends parse_parallel back to dom::parse, whose error
+    // is the only outcome: still no report.
+    totals.reset();
+    src.back() = ',';
+    bool failed = false;
+    try {
+      dom::parse_parallel(src, pool, std::pmr::new_delete_resource(),
+                          {.chunk_size = 256});
+    } catch (const dom::parse_error &) {
+      failed = true;
+    }
+    assert(failed && totals.snapshot().parses == 0);
+  }
+
+  set_sink(previous);
+  return 0;
+}
@@ -0,0 +1,138 @@
+#ifndef GKXX_THREAD_POOL_HPP
+#define GKXX_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gkxx {
+
+/// @brief A fixed set of workers, each with its own task deque. A worker takes
+/// the newest task of its own deque and, when that is empty, steals the oldest
+/// task of another worker's deque.
+class work_stealing_pool {
+ public:
+  /// @brief A task receives the index of the worker running it, which can be
+  /// used to reach per-worker state. Tasks must not throw.
+  using task_type = std::function<void(std::size_t)>;
+
+  explicit work_stealing_pool(
+      std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+      : m_queues(std::max<std::size_t>(threads, 1)) {
+    for (auto &queue : m_queues)
+      queue = std::make_unique<task_queue>();
+    for (std::size_t i = 0; i != m_queues.size(); ++i)
+      m_workers.emplace_back([this, i] { work(i); });
+  }
+
+  work_stealing_pool(const work_stealing_pool &) = delete;
+  work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+  ~work_stealing_pool() {
+    {
+      std::lock_guard lock{m_mutex};
+      m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers)
+      worker.join();
+  }
+
+  std::size_t size() const noexcept {
+    return m_workers.size();
+  }
+
+  /// @brief Queues a task, spreading tasks over the workers' deques.
+  void submit(task_type task) {
+    auto i = m_next_queue.fetch_add(1, std::memory_order_relaxed) %
+             m_queues.size();
+    // Counted first, so that a worker never sees a task it has not been told
+    // about; at worst it checks the deques once more.
+    {
+      std::lock_guard lock{m_mutex};
+      ++m_queued;
+      ++m_pending;
+    }
+    {
+      std::lock_guard lock{m_queues[i]->mutex};
+      m_queues[i]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+  }
+
+  /// @brief Blocks until every submitted task has finished.
+  void wait() {
+    std::unique_lock lock{m_mutex};
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+  }
+
+ private:
+  struct task_queue {
+    std::mutex mutex;
+    std::deque<task_type> tasks;
+  };
+
+  bool pop_own(std::size_t i, task_type &task) {
+    std::lock_guard lock{m_queues[i]->mutex};
+    if (m_queues[i]->tasks.empty())
+      return false;
+    task = std::move(m_queues[i]->tasks.back());
+    m_queues[i]->tasks.pop_back();
+    return true;
+  }
+
+  bool steal(std::size_t thief, task_type &task) {
+    for (std::size_t k = 1; k != m_queues.size(); ++k) {
+      auto &victim = *m_queues[(thief + k) % m_queues.size()];
+      std::lock_guard lock{victim.mutex};
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(std::size_t i) {
+    while (true) {
+      task_type task;
+      if (pop_own(i, task) || steal(i, task)) {
+        {
+          std::lock_guard lock{m_mutex};
+          --m_queued;
+        }
+        task(i);
+        std::lock_guard lock{m_mutex};
+        if (--m_pending == 0)
+          m_idle.notify_all();
+        continue;
+      }
+      std::unique_lock lock{m_mutex};
+      m_wake.wait(lock, [this] { return m_stopping || m_queued > 0; });
+      if (m_stopping && m_queued == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<task_queue>> m_queues;
+  std::vector<std::thread> m_workers;
+  std::atomic<std::size_t> m_next_queue{0};
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  std::size_t m_queued = 0;  // in some deque
+  std::size_t m_pending = 0; // queued or running
+  bool m_stopping = false;
+};
+
+} // namespace gkxx
+
+#endif // GKXX_THREAD_POOL_HPP
@@ -0,0 +1,165 @@
+#ifndef GKXX_TYPE_ID_HPP
+#define GKXX_TYPE_ID_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "fixed_string.hpp"
+#include "type_name.hpp"
+
+namespace gkxx {
+
+namespace detail {
+
+  // 64-bit FNV-1a
+  inline constexpr std::uint64_t fnv1a(std::string_view str) noexcept {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (auto c : str) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+} // namespace detail
+
+/// @brief Hash of the type name of T. Stable across translation units and
+/// builds made with the same compiler, since it only depends on the name the
+/// compiler prints for T.
+template <typename T>
+inline constexpr std::uint64_t type_id_v =
+    detail::fnv1a(type_name_v<T>.to_string_view());
+
+namespace detail {
+
+  template <std::size_t Capacity>
+  struct slot_layout {
+    static constexpr auto capacity = Capacity;
+    unsigned shift = 0;
+    bool found = false;
+  };
+
+  template <std::size_t Capacity, std::size_t N>
+  consteval auto find_slot_layout(const std::array<std::uint64_t, N> &ids) {
+    slot_layout<Capacity> layout;
+    for (unsigned shift = 0; shift + 1 < 64 && !layout.found; ++shift) {
+      bool used[Capacity]{};
+      bool collision = false;
+      for (auto id : ids) {
+        auto slot = (id >> shift) & (Capacity - 1);
+        if (used[slot]) {
+          collision = true;
+          break;
+        }
+        used[slot] = true;
+      }
+      if (!collision) {
+        layout.shift = shift;
+        layout.found = true;
+      }
+    }
+    return layout;
+  }
+
+  // Smallest power-of-two table (at least twice the number of types) for
+  // which some window of the id bits maps every registered type to its own
+  // slot.
+  template <std::size_t Capacity, auto Ids>
+  consteval auto make_slot_layout() {
+    constexpr auto layout = find_slot_layout<Capacity>(Ids);
+    if constexpr (layout.found || Capacity >= (std::size_t{1} << 16))
+      return layout;
+    else
+      return make_slot_layout<Capacity * 2, Ids>();
+  }
+
+  inline constexpr std::size_t initial_capacity(std::size_t n) noexcept {
+    std::size_t cap = 2;
+    while (cap < 2 * n)
+      cap *= 2;
+    return cap;
+  }
+
+  template <auto...>
+  inline constexpr auto has_duplicate_id = false;
+
+  template <auto First, auto... Rest>
+  inline constexpr auto has_duplicate_id<First, Rest...> =
+      ((First == Rest) || ...) || has_duplicate_id<Rest...>;
+
+} // namespace detail
+
+/// @brief Maps the type ids of Ts... to handlers through a collision-free
+/// table computed at compile time, so that a lookup is a shift, a mask and one
+/// comparison.
+template <typename... Ts>
+  requires(!detail::has_duplicate_id<type_id_v<Ts>...>)
+struct type_registry {
+  static constexpr std::array<std::uint64_t, sizeof...(Ts)> ids{
+      type_id_v<Ts>...};
+
+ private:
+  static constexpr auto layout =
+      detail::make_slot_layout<detail::initial_capacity(sizeof...(Ts)), ids>();
+  static_assert(layout.found, "cannot build a dispatch table for these types");
+
+  static constexpr std::size_t slot_of(std::uint64_t id) noexcept {
+    return (id >> layout.shift) & (layout.capacity - 1);
+  }
+
+  static constexpr auto make_slot_ids() noexcept {
+    std::array<std::uint64_t, layout.capacity> result{};
+    std::array<bool, layout.capacity> used{};
+    for (auto id : ids) {
+      result[slot_of(id)] = id;
+      used[slot_of(id)] = true;
+    }
+    // Fill an empty slot with a value that belongs to another slot, so that
+    // no id probing this slot can ever compare equal to it.
+    for (std::size_t i = 0; i != layout.capacity; ++i)
+      if (!used[i])
+        result[i] = static_cast<std::uint64_t>((i + 1) & (layout.capacity - 1))
+                    << layout.shift;
+    return result;
+  }
+  static constexpr auto slot_ids = make_slot_ids();
+
+ public:
+  static constexpr auto size = sizeof...(Ts);
+
+  template <typename T>
+  static constexpr bool contains = ((std::is_same_v<T, Ts>) || ...);
+
+  static constexpr bool contains_id(std::uint64_t id) noexcept {
+    return slot_ids[slot_of(id)] == id;
+  }
+
+  /// @brief Calls handler(std::type_identity<T>{}, args...) for the type T
+  /// whose id is `id`.
+  /// @return false if no registered type has this id.
+  template <typename Handler, typename... Args>
+  static constexpr bool dispatch(std::uint64_t id, Handler &&handler,
+                                 Args &&...args) {
+    using fn_t = void (*)(Handler &, Args &...);
+    constexpr fn_t entries[] = {[](Handler &h, Args &...as) {
+      h(std::type_identity<Ts>{}, as...);
+    }...};
+    constexpr auto table = [&] {
+      std::array<fn_t, layout.capacity> result{};
+      for (std::size_t i = 0; i != sizeof...(Ts); ++i)
+        result[slot_of(ids[i])] = entries[i];
+      return result;
+    }();
+    auto slot = slot_of(id);
+    if (slot_ids[slot] != id)
+      return false;
+    table[slot](handler, args...);
+    return true;
+  }
+};
+
+} // namespace gkxx
+
+#endif // GKXX_TYPE_ID_HPP
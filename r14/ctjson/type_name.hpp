@@ -5,6 +5,10 @@
 
 #include <string_view>
 
+#if __cplusplus > 201703L
+#include "fixed_string.hpp"
+#endif
+
 namespace gkxx {
 
 template <typename T>
@@ -32,6 +36,22 @@ constexpr auto get_type_name() {
   return function.substr(start, size);
 }
 
+#if __cplusplus > 201703L
+
+/// @brief The name of T as a fixed_string, usable as a template argument.
+template <typename T>
+consteval auto get_type_name_fixed() {
+  constexpr auto name = get_type_name<T>();
+  char data[name.size() + 1]{};
+  std::copy_n(name.data(), name.size(), data);
+  return fixed_string<name.size()>(data);
+}
+
+template <typename T>
+inline constexpr auto type_name_v = get_type_name_fixed<T>();
+
+#endif // C++20
+
 } // namespace gkxx
 
 #else
@@ -0,0 +1,92 @@
+#ifndef GKXX_CTJSON_VISIT_HPP
+#define GKXX_CTJSON_VISIT_HPP
+
+#include "ctjson.hpp"
+
+namespace gkxx::ctjson {
+
+namespace detail {
+
+  template <typename Doc>
+  struct for_each_member_impl;
+
+  template <CMember... Members>
+  struct for_each_member_impl<Object<Members...>> {
+    template <typename F>
+    static constexpr void apply(F &f) {
+      (f(fixed_string_constant<Members::key>{}, typename Members::value{}),
+       ...);
+    }
+  };
+
+  template <typename Doc>
+  struct for_each_element_impl;
+
+  template <CValue... Values>
+  struct for_each_element_impl<Array<Values...>> {
+    template <typename F>
+    static constexpr void apply(F &f) {
+      (f(Values{}), ...);
+    }
+  };
+
+  template <CNode Node>
+  struct visit_impl {
+    template <typename F>
+    static constexpr void apply(F &f) {
+      f(Node{});
+    }
+  };
+
+  template <CMember... Members>
+  struct visit_impl<Object<Members...>> {
+    template <typename F>
+    static constexpr void apply(F &f) {
+      f(Object<Members...>{});
+      (visit_impl<Members>::apply(f), ...);
+    }
+  };
+
+  template <CValue... Values>
+  struct visit_impl<Array<Values...>> {
+    template <typename F>
+    static constexpr void apply(F &f) {
+      f(Array<Values...>{});
+      (visit_impl<Values>::apply(f), ...);
+    }
+  };
+
+  template <fixed_string Key, CValue Value>
+  struct visit_impl<Member<Key, Value>> {
+    template <typename F>
+    static constexpr void apply(F &f) {
+      f(Member<Key, Value>{});
+      visit_impl<Value>::apply(f);
+    }
+  };
+
+} // namespace detail
+
+/// @brief Calls f(key, value) for every member of the object Doc, where key is
+/// a fixed_string_constant and value is an instance of the member's node type.
+template <meta::specialization_of<Object> Doc, typename F>
+constexpr void for_each_member(F &&f) {
+  detail::for_each_member_impl<Doc>::apply(f);
+}
+
+/// @brief Calls f(value) for every element of the array Doc.
+template <meta::specialization_of<Array> Doc, typename F>
+constexpr void for_each_element(F &&f) {
+  detail::for_each_element_impl<Doc>::apply(f);
+}
+
+/// @brief Calls visitor(node) for Doc and every node below it in pre-order.
+/// Members are visited as Member<Key, Value> before their values.
+template <CNode Doc, typename Visitor>
+constexpr void visit(Visitor &&visitor) {
+  detail::visit_impl<Doc>::apply(visitor);
+}
+
+} // namespace gkxx::ctjson
+
+#endif // GKXX_CTJSON_VISIT_HPP
@@ -0,0 +1,470 @@
+#ifndef GKXX_CTJSON_WRITER_HPP
+#define GKXX_CTJSON_WRITER_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define GKXX_CTJSON_HAS_POSIX_WRITE 1
+#else
+#define GKXX_CTJSON_HAS_POSIX_WRITE 0
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "dom.hpp"
+
+// Writing a DOM back as JSON text.
+//
+// Values are written straight into one growable buffer: every scalar reserves
+// the most bytes it can take and is formatted in place, so nothing is
+// allocated per value, and a buffer that is cleared and reused keeps its
+// capacity. A buffer can also pass its contents on to a file descriptor
+// whenever it fills up.
+//
+// Strings are copied 32 (AVX2) or 16 (SSE2) bytes at a time, stopping only at
+// the bytes that need escaping, and what is left (or everything, without
+// SSE2) 8 bytes at a time with the same check done in a general register.
+// The short escapes are written for '\\', '"', '\n', '\r' and '\t', and the
+// other bytes below 0x20 as \u00XX, so that what is written is read back as
+// it was by every parser here. Integers are formatted two digits at a time
+// from a table.
+
+namespace gkxx::ctjson::dom {
+
+enum class Style : unsigned char {
+  Minified, // {"a":1,"b":[1,2]}
+  Spaced,   // {"a": 1, "b": [1, 2]}, as the to_string() of the node types
+  Pretty    // one member or element per line, as pretty_type_name()
+};
+
+struct WriteOptions {
+  Style style = Style::Minified;
+  std::size_t indent = 2; // per level, for Style::Pretty
+};
+
+class output_buffer {
+ public:
+  /// @brief Keeps everything in memory.
+  output_buffer() noexcept = default;
+
+#if GKXX_CTJSON_HAS_POSIX_WRITE
+  /// @brief Writes to fd whenever `capacity` bytes have gathered, on flush()
+  /// and on destruction. The descriptor is not closed.
+  explicit output_buffer(int fd, std::size_t capacity = std::size_t{1} << 16)
+      : m_fd{fd} {
+    grow(capacity);
+  }
+#endif
+
+  output_buffer(const output_buffer &) = delete;
+  output_buffer &operator=(const output_buffer &) = delete;
+
+  /// @brief Writes out what is left, ignoring errors. Call flush() first to
+  /// see them.
+  ~output_buffer() {
+    try {
+      flush();
+    } catch (const std::system_error &) {
+    }
+  }
+
+  /// @brief Makes room for n more bytes and returns where they go. They are
+  /// added by commit().
+  char *prepare(std::size_t n) {
+    if (m_capacity - m_size < n) {
+      if (m_fd >= 0)
+        flush();
+      if (m_capacity - m_size < n)
+        grow(std::max(m_size + n, m_capacity * 2));
+    }
+    return m_data.get() + m_size;
+  }
+  /// @param end The end of the bytes written since prepare().
+  void commit(const char *end) noexcept {
+    m_size = static_cast<std::size_t>(end - m_data.get());
+  }
+
+  void append(std::string_view bytes) {
+    auto out = prepare(bytes.size());
+    if (!bytes.empty())
+      std::memcpy(out, bytes.data(), bytes.size());
+    m_size += bytes.size();
+  }
+  void push_back(char c) {
+    *prepare(1) = c;
+    ++m_size;
+  }
+
+  /// @brief What has been written and not yet flushed.
+  std::string_view view() const noexcept {
+    return {m_data.get(), m_size};
+  }
+  std::size_t size() const noexcept {
+    return m_size;
+  }
+  std::size_t capacity() const noexcept {
+    return m_capacity;
+  }
+  /// @brief Discards the contents, keeping the capacity.
+  void clear() noexcept {
+    m_size = 0;
+  }
+
+  /// @brief Writes the contents to the file descriptor, if there is one.
+  /// @throws std::system_error if the write fails.
+  void flush() {
+#if GKXX_CTJSON_HAS_POSIX_WRITE
+    if (m_fd < 0)
+      return;
+    std::size_t done = 0;
+    while (done != m_size) {
+      auto n = ::write(m_fd, m_data.get() + done, m_size - done);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        throw std::system_error(errno, std::generic_category(),
+                                "cannot write output");
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    m_size = 0;
+#endif
+  }
+
+ private:
+  void grow(std::size_t capacity) {
+    capacity = std::max<std::size_t>(capacity, 256);
+    auto data = std::make_unique_for_overwrite<char[]>(capacity);
+    if (m_size != 0)
+      std::memcpy(data.get(), m_data.get(), m_size);
+    m_data = std::move(data);
+    m_capacity = capacity;
+  }
+
+  std::unique_ptr<char[]> m_data;
+  std::size_t m_size = 0;
+  std::size_t m_capacity = 0;
+  int m_fd = -1;
+};
+
+namespace detail {
+
+  // The letter following '\\' in the escape of each byte, 'u' for \u00XX, or 0
+  // if the byte is written as it is.
+  inline constexpr auto escape_letters = [] {
+    std::array<char, 256> letters{};
+    for (int c = 0; c != 0x20; ++c)
+      letters[c] = 'u';
+    letters['"'] = '"';
+    letters['\\'] = '\\';
+    letters['\n'] = 'n';
+    letters['\r'] = 'r';
+    letters['\t'] = 't';
+    return letters;
+  }();
+
+  inline constexpr auto digit_pairs = [] {
+    std::array<char, 200> pairs{};
+    for (int i = 0; i != 100; ++i) {
+      pairs[2 * i] = static_cast<char>('0' + i / 10);
+      pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+    }
+    return pairs;
+  }();
+
+  // At most 11 bytes: a sign and 10 digits.
+  inline char *write_integer(int n, char *out) noexcept {
+    auto u = static_cast<unsigned>(n);
+    if (n < 0) {
+      *out++ = '-';
+      u = 0u - u;
+    }
+    char digits[10];
+    auto first = digits + sizeof(digits);
+    while (u >= 100) {
+      first -= 2;
+      std::memcpy(first, &digit_pairs[u % 100 * 2], 2);
+      u /= 100;
+    }
+    if (u >= 10) {
+      first -= 2;
+      std::memcpy(first, &digit_pairs[u * 2], 2);
+    } else
+      *--first = static_cast<char>('0' + u);
+    auto length = static_cast<std::size_t>(digits + sizeof(digits) - first);
+    std::memcpy(out, first, length);
+    return out + length;
+  }
+
+  // At most 6 bytes.
+  inline char *escape_byte(char c, char *out) noexcept {
+    auto letter = escape_letters[static_cast<unsigned char>(c)];
+    if (letter == 0) {
+      *out++ = c;
+      return out;
+    }
+    *out++ = '\\';
+    *out++ = letter;
+    if (letter == 'u') {
+      constexpr char hex[] = "0123456789abcdef";
+      *out++ = '0';
+      *out++ = '0';
+      *out++ = hex[c >> 4];
+      *out++ = hex[c & 0xf];
+    }
+    return out;
+  }
+
+#if defined(__AVX2__)
+  struct escape_block {
+    static constexpr std::size_t width = 32;
+    // Copies the block at p to out and returns the mask of its bytes to
+    // escape.
+    static unsigned copy(const char *p, char *out) noexcept {
+      auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      auto is = [&](char c) {
+        return _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c));
+      };
+      // The bytes below 0x20 are those that 0x1f does not lower.
+      auto control = _mm256_cmpeq_epi8(
+          _mm256_min_epu8(block, _mm256_set1_epi8(0x1f)), block);
+      auto special =
+          _mm256_or_si256(_mm256_or_si256(is('"'), is('\\')), control);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), block);
+      return static_cast<unsigned>(_mm256_movemask_epi8(special));
+    }
+  };
+#elif defined(__SSE2__)
+  struct escape_block {
+    static constexpr std::size_t width = 16;
+    // Copies the block at p to out and returns the mask of its bytes to
+    // escape.
+    static unsigned copy(const char *p, char *out) noexcept {
+      auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+      auto is = [&](char c) {
+        return _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+      };
+      // The bytes below 0x20 are those that 0x1f does not lower.
+      auto control =
+          _mm_cmpeq_epi8(_mm_min_epu8(block, _mm_set1_epi8(0x1f)), block);
+      auto special = _mm_or_si128(_mm_or_si128(is('"'), is('\\')), control);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), block);
+      return static_cast<unsigned>(_mm_movemask_epi8(special));
+    }
+  };
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  // Room needed past the escaped bytes, which whole blocks may overwrite.
+  inline constexpr std::size_t escape_slack = escape_block::width;
+
+  // Escapes the bytes of the block at p up to its first byte to escape, or
+  // the whole block if there is none, of which only `left` bytes are valid.
+  inline char *escape_some(const char *&p, std::size_t left,
+                           char *out) noexcept {
+    auto mask = escape_block::copy(p, out);
+    if (left < escape_block::width)
+      mask &= (1u << left) - 1;
+    if (mask == 0) {
+      auto n = std::min(left, escape_block::width);
+      p += n;
+      return out + n;
+    }
+    auto clean = static_cast<std::size_t>(std::countr_zero(mask));
+    p += clean;
+    return escape_byte(*p++, out + clean);
+  }
+#else
+  inline constexpr std::size_t escape_slack = 0;
+#endif
+
+  // Whether any of the 8 bytes of word needs escaping.
+  inline bool has_escape(std::uint64_t word) noexcept {
+    constexpr std::uint64_t ones = 0x0101010101010101;
+    auto has = [&](char c) {
+      auto x = word ^ (ones * static_cast<unsigned char>(c));
+      return (x - ones) & ~x & (ones << 7);
+    };
+    // Bytes below 0x20: taking 0x20 away sets their high bit, and any borrow
+    // into the bytes above only follows such a byte.
+    auto control = (word - ones * 0x20) & ~word & (ones << 7);
+    return (has('"') | has('\\') | control) != 0;
+  }
+
+  // Copies [p, end) 8 bytes at a time where none needs escaping, and a byte
+  // at a time elsewhere. The last few bytes are copied with the word ending
+  // at `end` if nothing in it needs escaping: the bytes it shares with the
+  // word before were then copied as they are, and are only written again.
+  inline char *escape_words(const char *begin, const char *p, const char *end,
+                            char *out) noexcept {
+    std::uint64_t word;
+    for (; end - p >= 8; p += 8) {
+      std::memcpy(&word, p, 8);
+      if (!has_escape(word)) {
+        std::memcpy(out, &word, 8);
+        out += 8;
+      } else
+        for (auto i = 0; i != 8; ++i)
+          out = escape_byte(p[i], out);
+    }
+    if (p != end && end - begin >= 8) {
+      std::memcpy(&word, end - 8, 8);
+      if (!has_escape(word)) {
+        auto left = end - p;
+        std::memcpy(out + left - 8, &word, 8);
+        return out + left;
+      }
+    }
+    for (; p != end; ++p)
+      out = escape_byte(*p, out);
+    return out;
+  }
+
+  // At most 6 * str.size() bytes, and whatever escape_slack bytes follow them
+  // may be overwritten.
+  inline char *write_escaped(std::string_view str, char *out) noexcept {
+    auto p = str.data();
+    auto end = p + str.size();
+#if defined(__AVX2__) || defined(__SSE2__)
+    // The output never runs ahead of six times the input read, so with the slack
+    // a whole block always fits.
+    while (static_cast<std::size_t>(end - p) >= escape_block::width)
+      out = escape_some(p, escape_block::width, out);
+#endif
+    return escape_words(str.data(), p, end, out);
+  }
+
+  class Writer {
+   public:
+    Writer(output_buffer &out, const WriteOptions &options) noexcept
+        : m_out{out}, m_options{options} {}
+
+    void write_value(const Value &value, std::size_t depth) {
+      switch (value.kind()) {
+      case Kind::Integer:
+        m_out.commit(write_integer(value.as_integer(), m_out.prepare(11)));
+        break;
+      case Kind::String:
+        write_string(value.as_string());
+        break;
+      case Kind::True:
+        m_out.append("true");
+        break;
+      case Kind::False:
+        m_out.append("false");
+        break;
+      case Kind::Null:
+        m_out.append("null");
+        break;
+      case Kind::Array:
+        write_array(value.as_array(), depth);
+        break;
+      case Kind::Object:
+        write_object(value.as_object(), depth);
+        break;
+      }
+    }
+
+   private:
+    void write_string(std::string_view str) {
+      auto out = m_out.prepare(6 * str.size() + 2 + escape_slack);
+      *out++ = '"';
+      out = write_escaped(str, out);
+      *out++ = '"';
+      m_out.commit(out);
+    }
+
+    // Before the element or member i of a container at `depth`.
+    void write_separator(std::size_t i, std::size_t depth) {
+      if (m_options.style == Style::Pretty) {
+        auto spaces = (depth + 1) * m_options.indent;
+        auto out = m_out.prepare(spaces + 2);
+        if (i != 0)
+          *out++ = ',';
+        *out++ = '\n';
+        std::memset(out, ' ', spaces);
+        m_out.commit(out + spaces);
+      } else if (i != 0)
+        m_out.append(m_options.style == Style::Spaced ? ", " : ",");
+    }
+
+    void write_closing(char bracket, std::size_t depth) {
+      if (m_options.style == Style::Pretty) {
+        auto spaces = depth * m_options.indent;
+        auto out = m_out.prepare(spaces + 2);
+        *out++ = '\n';
+        std::memset(out, ' ', spaces);
+        out += spaces;
+        *out++ = bracket;
+        m_out.commit(out);
+      } else
+        m_out.push_back(bracket);
+    }
+
+    void write_array(const Array &elements, std::size_t depth) {
+      if (elements.empty()) {
+        m_out.append("[]");
+        return;
+      }
+      m_out.push_back('[');
+      for (std::size_t i = 0; i != elements.size(); ++i) {
+        write_separator(i, depth);
+        write_value(elements[i], depth + 1);
+      }
+      write_closing(']', depth);
+    }
+
+    void write_object(const Object &members, std::size_t depth) {
+      if (members.empty()) {
+        m_out.append("{}");
+        return;
+      }
+      m_out.push_back('{');
+      for (std::size_t i = 0; i != members.size(); ++i) {
+        write_separator(i, depth);
+        write_string(members.key(i));
+        m_out.append(m_options.style == Style::Minified ? ":" : ": ");
+        write_value(members.value(i), depth + 1);
+      }
+      write_closing('}', depth);
+    }
+
+    output_buffer &m_out;
+    WriteOptions m_options;
+  };
+
+} // namespace detail
+
+/// @brief Appends the JSON text of value to out.
+inline void write(const Value &value, output_buffer &out,
+                  const WriteOptions &options = {}) {
+  detail::Writer{out, options}.write_value(value, 0);
+}
+
+/// @brief The JSON text of value.
+inline std::string to_string(const Value &value,
+                             const WriteOptions &options = {}) {
+  output_buffer out;
+  write(value, out, options);
+  return std::string(out.view());
+}
+
+} // namespace gkxx::ctjson::dom
+
+#endif // GKXX_CTJSON_WRITER_HPP
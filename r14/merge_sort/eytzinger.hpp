@@ -0,0 +1,127 @@
+#ifndef GKXX_EYTZINGER_HPP
+#define GKXX_EYTZINGER_HPP
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "merge_sort.hpp"
+
+/*
+Eytzinger layout: the sorted keys stored as a complete binary search tree in
+BFS order, 1-based, so that the children of node k are 2k and 2k + 1.
+
+  sorted:    1 2 3 4 5 6 7
+  eytzinger: _ 4 2 6 1 3 5 7
+
+A search walks down from the root touching the nodes of one level after
+another. Those sit next to each other in memory, so the nodes four levels
+below k (16 ints, one cache line) can be prefetched while k is compared.
+ */
+
+// Number of ints in a 64-byte cache line.
+inline constexpr std::size_t eytzinger_block = 16;
+
+/// @brief Writes the sorted keys sorted[0..n) to out[1..n] in Eytzinger order.
+/// If ranks is not null, ranks[k] is set to the position in sorted of out[k].
+constexpr std::size_t eytzinger_fill(const int *sorted, std::size_t n,
+                                     int *out, std::size_t *ranks = nullptr,
+                                     std::size_t i = 0, std::size_t k = 1) {
+  if (k <= n) {
+    i = eytzinger_fill(sorted, n, out, ranks, i, 2 * k);
+    if (ranks)
+      ranks[k] = i;
+    out[k] = sorted[i++];
+    i = eytzinger_fill(sorted, n, out, ranks, i, 2 * k + 1);
+  }
+  return i;
+}
+
+/// @brief Branchless lower bound in the Eytzinger table[1..n]. Returns the
+/// index of the first key not less than x, or 0 if there is none.
+///
+/// The loop has no data-dependent branch: each step picks a child with
+/// arithmetic. It takes floor(log2 n) + 1 steps, or one fewer on paths that
+/// end above the last, partly filled level; only when n + 1 is a power of two
+/// do all paths take the same number. Duplicate keys are fine: the answer is
+/// the first of them. For the prefetch to cover one line, table should be
+/// 64-byte aligned.
+constexpr std::size_t eytzinger_lower_bound(const int *table, std::size_t n,
+                                            int x) noexcept {
+  std::size_t k = 1;
+  while (k <= n) {
+#if defined(__GNUC__)
+    // The line may lie far past the end of the table, where even forming a
+    // pointer is undefined, so its address is computed as an integer. A
+    // prefetch of any address is harmless.
+    if (!std::is_constant_evaluated())
+      __builtin_prefetch(reinterpret_cast<const void *>(
+          reinterpret_cast<std::uintptr_t>(table) +
+          k * eytzinger_block * sizeof(int)));
+#endif
+    k = 2 * k + static_cast<std::size_t>(table[k] < x);
+  }
+  // The trailing ones are the right turns taken after the last left turn,
+  // which was made at the answer.
+  return k >> (std::countr_one(k) + 1);
+}
+
+template <std::size_t N>
+struct eytzinger_arrays {
+  std::array<int, N + 1> keys{};
+  std::array<std::size_t, N + 1> ranks{};
+};
+
+template <int... content>
+consteval auto make_eytzinger_arrays() {
+  constexpr std::size_t n = sizeof...(content);
+  const int sorted[n + 1]{content..., 0};
+  eytzinger_arrays<n> result;
+  eytzinger_fill(sorted, n, result.keys.data(), result.ranks.data());
+  result.ranks[0] = n;
+  return result;
+}
+
+template <int... content>
+consteval bool is_non_decreasing() {
+  const int keys[]{content..., 0};
+  for (std::size_t i = 1; i < sizeof...(content); ++i)
+    if (keys[i] < keys[i - 1])
+      return false;
+  return true;
+}
+
+template <typename>
+struct eytzinger_table;
+
+/// @brief The keys of a sorted int_list, e.g. a merge_sort result, in
+/// Eytzinger layout for fast lookups at run time. The keys may repeat.
+template <int... content>
+struct eytzinger_table<int_list<content...>> {
+  static_assert(is_non_decreasing<content...>(),
+                "eytzinger_table expects non-decreasing keys");
+
+  static constexpr std::size_t size = sizeof...(content);
+
+  // keys[0] is unused.
+  alignas(64) static constexpr std::array<int, size + 1> keys =
+      make_eytzinger_arrays<content...>().keys;
+  // ranks[k] is the position of keys[k] in the int_list; ranks[0] is size.
+  static constexpr std::array<std::size_t, size + 1> ranks =
+      make_eytzinger_arrays<content...>().ranks;
+
+  /// @brief The position in the int_list of the first key not less than x, or
+  /// size if there is none, like std::lower_bound.
+  static constexpr std::size_t lower_bound(int x) noexcept {
+    return ranks[eytzinger_lower_bound(keys.data(), size, x)];
+  }
+
+  static constexpr bool contains(int x) noexcept {
+    auto k = eytzinger_lower_bound(keys.data(), size, x);
+    return k != 0 && keys[k] == x;
+  }
+};
+
+#endif // GKXX_EYTZINGER_HPP
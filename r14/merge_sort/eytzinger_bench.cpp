@@ -0,0 +1,113 @@
+// Lookups in an Eytzinger table against std::lower_bound on a sorted array,
+// for tables from 4 KiB (L1) to 256 MiB (past the last-level cache). Both
+// give the position in the sorted array, so the Eytzinger lookups include
+// the ranks[] load that maps a node to it, as eytzinger_table does.
+//
+//   g++ -std=c++20 -O2 -march=native eytzinger_bench.cpp -o eytzinger_bench
+//   ./eytzinger_bench [queries]
+
+#include "eytzinger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace {
+
+using keys = merge_sort<int_list<95554, 67802, 72486, 31920, 84531, 61547,
+                                 42905, 26623, 42834, 2156>>::result;
+using table = eytzinger_table<keys>;
+
+static_assert(table::lower_bound(0) == 0);
+static_assert(table::lower_bound(42834) == 3);
+static_assert(table::lower_bound(42835) == 4);
+static_assert(table::lower_bound(100000) == table::size);
+static_assert(table::contains(61547) && !table::contains(61548));
+
+// Repeated keys: lower_bound gives the first of them.
+using repeated = eytzinger_table<merge_sort<int_list<5, 3, 5, 1, 3, 5>>::result>;
+static_assert(repeated::size == 6);
+static_assert(repeated::lower_bound(0) == 0 && repeated::lower_bound(1) == 0);
+static_assert(repeated::lower_bound(3) == 1 && repeated::lower_bound(4) == 3);
+static_assert(repeated::lower_bound(5) == 3 && repeated::lower_bound(6) == 6);
+static_assert(repeated::contains(5) && !repeated::contains(4));
+
+struct aligned_delete {
+  void operator()(int *p) const noexcept {
+    ::operator delete[](p, std::align_val_t{64});
+  }
+};
+
+using aligned_ints = std::unique_ptr<int[], aligned_delete>;
+
+aligned_ints allocate_aligned(std::size_t n) {
+  return aligned_ints(static_cast<int *>(
+      ::operator new[](n * sizeof(int), std::align_val_t{64})));
+}
+
+template <typename F>
+double nanoseconds_per_query(const std::vector<int> &queries, F &&search) {
+  using clock = std::chrono::steady_clock;
+  auto best = clock::duration::max();
+  std::size_t sink = 0;
+  for (int round = 0; round != 3; ++round) {
+    auto start = clock::now();
+    for (auto q : queries)
+      sink += search(q);
+    best = std::min(best, clock::now() - start);
+  }
+  if (sink == 42)
+    std::puts("");
+  return std::chrono::duration<double, std::nano>(best).count() /
+         queries.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::size_t query_count =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+  std::mt19937 rng{20240501};
+
+  std::printf("%12s %12s %14s %14s\n", "keys", "bytes", "lower_bound ns",
+              "eytzinger ns");
+  for (std::size_t n = 1 << 10; n <= (std::size_t{1} << 26); n <<= 2) {
+    // Even keys, so that half of the queries miss.
+    std::vector<int> sorted(n);
+    for (std::size_t i = 0; i != n; ++i)
+      sorted[i] = static_cast<int>(2 * i);
+    auto layout = allocate_aligned(n + 1);
+    std::vector<std::size_t> ranks(n + 1);
+    eytzinger_fill(sorted.data(), n, layout.get(), ranks.data());
+    ranks[0] = n;
+
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(2 * n));
+    std::vector<int> queries(query_count);
+    for (auto &q : queries)
+      q = dist(rng);
+
+    for (auto q : queries) {
+      auto expected = std::lower_bound(sorted.begin(), sorted.end(), q);
+      auto k = eytzinger_lower_bound(layout.get(), n, q);
+      if (ranks[k] != static_cast<std::size_t>(expected - sorted.begin())) {
+        std::fprintf(stderr, "mismatch for %d with %zu keys\n", q, n);
+        return 1;
+      }
+    }
+
+    auto baseline = nanoseconds_per_query(queries, [&](int q) {
+      return static_cast<std::size_t>(
+          std::lower_bound(sorted.begin(), sorted.end(), q) - sorted.begin());
+    });
+    auto eytzinger = nanoseconds_per_query(queries, [&](int q) {
+      return ranks[eytzinger_lower_bound(layout.get(), n, q)];
+    });
+    std::printf("%12zu %12zu %14.1f %14.1f\n", n, n * sizeof(int), baseline,
+                eytzinger);
+  }
+}